@@ -0,0 +1,34 @@
+#include "eeemcal_analyses.h"
+
+#include <TROOT.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv) {
+    int run_number = -1;
+    int n_threads = 0;
+    bool follow = false;
+    FollowOptions follow_options;
+    for (int i = 1; i < argc; i++) {
+        if (parse_follow_option(argc, argv, i, follow, follow_options) || parse_render_option(argc, argv, i)) {
+            continue;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = std::atoi(argv[++i]);
+        } else {
+            run_number = std::atoi(argv[i]);
+        }
+    }
+    if (run_number < 0) {
+        std::cerr << "Usage: " << argv[0] << " <run number> [--follow] [-j threads] [--no-plots]" << std::endl;
+        std::cerr << "  -j  threads for the fits, 0 (default) for one per core, 1 for serial" << std::endl;
+        std::cerr << RENDER_USAGE;
+        std::cerr << FOLLOW_USAGE;
+        return 1;
+    }
+    gROOT->SetBatch(true);
+    bool ok = follow ? adc_tot_correlation_follow(run_number, follow_options, n_threads)
+                     : adc_tot_correlation_offline(run_number, n_threads);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "eeemcal_analyses.h"
+
+#include <TROOT.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char *const MODULE_NAMES = "adc_sum, adc_tot, event_display, event_display_tot, position, index, timing, cluster";
+
+static std::unique_ptr<AnalysisModule> make_module(const std::string &name, int run_number, int n_threads, bool use_cache,
+                                                   double beam_energy, EventDisplayOptions display) {
+    if (name == "adc_sum") {
+        return make_adc_sum_module(run_number, n_threads, use_cache, beam_energy);
+    } else if (name == "adc_tot") {
+        return make_adc_tot_module(run_number, n_threads);
+    } else if (name == "event_display") {
+        display.branch = BRANCH_ADC;
+        return make_event_display_module(run_number, display);
+    } else if (name == "event_display_tot") {
+        display.branch = BRANCH_TOT;
+        return make_event_display_module(run_number, display);
+    } else if (name == "position") {
+        return make_position_summary_module(run_number);
+    } else if (name == "index") {
+        return make_event_index_module(run_number);
+    } else if (name == "timing") {
+        return make_timing_summary_module(run_number);
+    } else if (name == "cluster") {
+        return make_cluster_summary_module(run_number);
+    }
+    return nullptr;
+}
+
+int main(int argc, char **argv) {
+    int run_number = -1;
+    int n_threads = 0;
+    bool use_cache = true;
+    double beam_energy = 0;
+    std::string module_list = "adc_sum,adc_tot,index,timing,cluster";
+    EventDisplayOptions display;
+    for (int i = 1; i < argc; i++) {
+        if (parse_render_option(argc, argv, i)) {
+            continue;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--beam-energy") == 0 && i + 1 < argc) {
+            beam_energy = std::atof(argv[++i]);
+        } else if (strcmp(argv[i], "--modules") == 0 && i + 1 < argc) {
+            module_list = argv[++i];
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = false;
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            if (!parse_event_list(argv[++i], display.events)) {
+                return 1;
+            }
+        } else {
+            run_number = std::atoi(argv[i]);
+        }
+    }
+    if (run_number < 0) {
+        std::cerr << "Usage: " << argv[0] << " <run number> [-j threads] [--beam-energy GeV] [--modules a,b,...] [--no-cache]" << std::endl;
+        std::cerr << "  Reads the run once for all the selected analyses" << std::endl;
+        std::cerr << "  -j  threads for the event loop and the fits, 0 (default) for one per core" << std::endl;
+        std::cerr << "  --beam-energy  start the fits from earlier runs near this energy, default from the run catalog" << std::endl;
+        std::cerr << "  --modules  from " << MODULE_NAMES << ", default adc_sum,adc_tot,index,timing,cluster" << std::endl;
+        std::cerr << "  --no-cache  do not write the feature cache of adc_sum, which single_crystal_ADC_sum reruns read" << std::endl;
+        std::cerr << "  --events  events of the event displays, e.g. 0-9,15 (default 0-9)" << std::endl;
+        std::cerr << RENDER_USAGE;
+        return 1;
+    }
+
+    // beam energy from the run catalog unless given
+    RunInfo run_info;
+    if (beam_energy <= 0 && find_run(run_number, run_info)) {
+        beam_energy = run_info.beam_energy;
+    }
+
+    if (display.events.empty()) {
+        parse_event_list("0-9", display.events);
+    }
+
+    std::vector<std::unique_ptr<AnalysisModule>> modules;
+    std::vector<AnalysisModule*> module_pointers;
+    std::stringstream names(module_list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        auto module = make_module(name, run_number, n_threads, use_cache, beam_energy, display);
+        if (!module) {
+            std::cerr << "Unknown module " << name << ", the modules are " << MODULE_NAMES << std::endl;
+            return 1;
+        }
+        module_pointers.push_back(module.get());
+        modules.push_back(std::move(module));
+    }
+
+    gROOT->SetBatch(true);
+    return run_analysis_modules(run_number, module_pointers, n_threads) ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_event_index.h"
+
+#include <TROOT.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv) {
+    int run_number = -1;
+    int n_workers = 0;
+    EventDisplayOptions options;
+    EventQuery query;
+    bool use_index = false;
+    for (int i = 1; i < argc; i++) {
+        if (parse_event_query_option(argc, argv, i, query, use_index)) {
+            continue;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_workers = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tot") == 0) {
+            options.branch = BRANCH_TOT;
+        } else if (strcmp(argv[i], "--png") == 0) {
+            options.images = true;
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            options.mode = strcmp(mode, "16i") == 0 ? READOUT_16I
+                         : strcmp(mode, "4x4") == 0 ? READOUT_4X4
+                         : strcmp(mode, "16p") == 0 ? READOUT_16P : -1;
+            if (options.mode < 0) {
+                std::cerr << "Unknown readout mode " << mode << ", the modes are 16i, 4x4 and 16p" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            if (!parse_event_list(argv[++i], options.events)) {
+                return 1;
+            }
+        } else {
+            run_number = std::atoi(argv[i]);
+        }
+    }
+    if (!query.valid) {
+        return 1;
+    }
+    if (run_number < 0) {
+        std::cerr << "Usage: " << argv[0] << " <run number> [--tot] [--mode 16i|4x4|16p] [--events 0-9,15] [--png] [-j workers] [query options]" << std::endl;
+        std::cerr << "  Draws the ADC (or with --tot the ToT) waveforms of the events" << std::endl;
+        std::cerr << "  --mode  SiPM layout of the readout, default 16i" << std::endl;
+        std::cerr << "  --events  default 0-9" << std::endl;
+        std::cerr << "  --png  one image per event instead of the pages of a PDF" << std::endl;
+        std::cerr << "  -j  worker processes, 0 (default) for one per core" << std::endl;
+        std::cerr << "  With any of these the events are selected from the event index of the run:" << std::endl;
+        std::cerr << EVENT_QUERY_USAGE;
+        return 1;
+    }
+    // Events from the index, e.g. --crystal 13 --top 50
+    if (use_index) {
+        std::vector<EventKey> keys;
+        if (!read_event_index(run_number, keys)) {
+            return 1;
+        }
+        for (const EventKey &key : query_event_index(keys, query)) {
+            options.events.push_back(key.entry);
+        }
+        if (options.events.empty()) {
+            std::cerr << "No events in the index match the query" << std::endl;
+            return 1;
+        }
+    }
+    if (options.events.empty()) {
+        parse_event_list("0-9", options.events);
+    }
+    gROOT->SetBatch(true);
+    return display_events(run_number, options, n_workers) ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#include "eeemcal_analyses.h"
+
+#include <TROOT.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    std::string name;
+    std::vector<int> runs;
+    int n_threads = 0;
+    bool adc_sum = true;
+    bool adc_tot = true;
+    RunQuery query;
+    bool use_catalog = false;
+    for (int i = 1; i < argc; i++) {
+        if (parse_render_option(argc, argv, i)) {
+            continue;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--adc-sum-only") == 0) {
+            adc_tot = false;
+        } else if (strcmp(argv[i], "--adc-tot-only") == 0) {
+            adc_sum = false;
+        } else if (strcmp(argv[i], "--beam-energy") == 0 && i + 1 < argc) {
+            query.beam_energy = std::atof(argv[++i]);
+            use_catalog = true;
+        } else if (strcmp(argv[i], "--first") == 0 && i + 1 < argc) {
+            query.first_run = std::atoi(argv[++i]);
+            use_catalog = true;
+        } else if (strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+            query.last_run = std::atoi(argv[++i]);
+            use_catalog = true;
+        } else if (strcmp(argv[i], "--good") == 0) {
+            query.good_only = true;
+            use_catalog = true;
+        } else if (name.empty()) {
+            name = argv[i];
+        } else {
+            runs.push_back(std::atoi(argv[i]));
+        }
+    }
+    // without run numbers, the runs matching the query in the run catalog
+    if (runs.empty() && use_catalog) {
+        for (const RunInfo &info : select_runs(query)) {
+            runs.push_back(info.run);
+        }
+        if (runs.empty()) {
+            std::cerr << "No runs in the run catalog match the selection" << std::endl;
+            return 1;
+        }
+    }
+    if (name.empty() || runs.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <name> <run number>... [-j threads] [--adc-sum-only | --adc-tot-only]" << std::endl;
+        std::cerr << "       " << argv[0] << " <name> [--first N] [--last M] [--beam-energy GeV] [--good] [-j threads]" << std::endl;
+        std::cerr << "  Adds the accumulator files of the runs and fits the sums, writing output/<name>_*" << std::endl;
+        std::cerr << "  Without run numbers the runs are selected from the run catalog, " RUN_CATALOG_PATH << std::endl;
+        std::cerr << "  -j  threads for reading the runs and for the fits, 0 (default) for one per core" << std::endl;
+        std::cerr << RENDER_USAGE;
+        return 1;
+    }
+    gROOT->SetBatch(true);
+    bool ok = true;
+    if (adc_sum) {
+        ok = merge_adc_sum_runs(name, runs, n_threads) && ok;
+    }
+    if (adc_tot) {
+        ok = merge_adc_tot_runs(name, runs, n_threads) && ok;
+    }
+    return ok ? 0 : 1;
+}
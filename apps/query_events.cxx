@@ -0,0 +1,56 @@
+#include "eeemcal_event_index.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char **argv) {
+    int run_number = -1;
+    bool list = false;
+    EventQuery query;
+    bool used = false;
+    for (int i = 1; i < argc; i++) {
+        if (parse_event_query_option(argc, argv, i, query, used)) {
+            continue;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else {
+            run_number = std::atoi(argv[i]);
+        }
+    }
+    if (!query.valid) {
+        return 1;
+    }
+    if (run_number < 0) {
+        std::cerr << "Usage: " << argv[0] << " <run number> [query options] [--list]" << std::endl;
+        std::cerr << "  Selects events from output/RunNNN_event_index.root, e.g. --crystal 13 --top 50" << std::endl;
+        std::cerr << "  --list  only the entries, comma separated, for event_display --events" << std::endl;
+        std::cerr << "  The leading crystal of an event without any hit is printed as 0" << std::endl;
+        std::cerr << EVENT_QUERY_USAGE;
+        return 1;
+    }
+
+    std::vector<EventKey> keys;
+    if (!read_event_index(run_number, keys)) {
+        return 1;
+    }
+    std::vector<EventKey> selected = query_event_index(keys, query);
+    if (list) {
+        for (size_t i = 0; i < selected.size(); i++) {
+            std::cout << (i ? "," : "") << selected[i].entry;
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+    std::cout << "entry\ttotal_sum\tcenter_sum\tleading_crystal\tleading_sum\tn_tot_active\tmulti_toa\tmulti_crystal\tx\ty\tx_sipm\ty_sipm" << std::endl;
+    for (const EventKey &key : selected) {
+        std::cout << key.entry << "\t" << key.total_sum << "\t" << key.center_sum << "\t"
+                  << (key.leading_crystal == NO_LEADING_CRYSTAL ? 0 : crystal_ID[key.leading_crystal])
+                  << "\t" << key.leading_sum << "\t" << key.n_tot_active << "\t" << bool(key.flags & EVENT_MULTI_TOA)
+                  << "\t" << bool(key.flags & EVENT_MULTI_CRYSTAL) << "\t" << key.x << "\t" << key.y
+                  << "\t" << key.x_sipm << "\t" << key.y_sipm << std::endl;
+    }
+    std::cerr << selected.size() << " of " << keys.size() << " events" << std::endl;
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "eeemcal_analyses.h"
+
+#include <TROOT.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    std::string name;
+    int n_workers = 0;
+    bool adc_sum = true;
+    bool adc_tot = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_workers = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--adc-sum-only") == 0) {
+            adc_tot = false;
+        } else if (strcmp(argv[i], "--adc-tot-only") == 0) {
+            adc_sum = false;
+        } else {
+            name = argv[i];
+        }
+    }
+    if (name.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <run number | name> [-j workers] [--adc-sum-only | --adc-tot-only]" << std::endl;
+        std::cerr << "  Draws the PDFs of the analyses from output/<name>_*_results.root, e.g. after --no-plots" << std::endl;
+        std::cerr << "  -j  worker processes, 0 (default) for one per core" << std::endl;
+        return 1;
+    }
+    // A run number stands for its outputs, RunNNN
+    if (std::isdigit(static_cast<unsigned char>(name[0]))) {
+        name = run_output_name(std::atoi(name.c_str())).file;
+    }
+
+    std::vector<RenderJob> jobs;
+    if (adc_sum) {
+        for (auto &job : adc_sum_render_jobs(name)) {
+            jobs.push_back(job);
+        }
+    }
+    if (adc_tot) {
+        for (auto &job : adc_tot_render_jobs(name)) {
+            jobs.push_back(job);
+        }
+    }
+    gROOT->SetBatch(true);
+    return render_documents(jobs, n_workers) ? 0 : 1;
+}
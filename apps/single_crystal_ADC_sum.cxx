@@ -0,0 +1,47 @@
+#include "eeemcal_analyses.h"
+
+#include <TROOT.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv) {
+    int run_number = -1;
+    int n_threads = 0;
+    bool follow = false;
+    FollowOptions follow_options;
+    bool use_cache = true;
+    double beam_energy = 0;
+    for (int i = 1; i < argc; i++) {
+        if (parse_follow_option(argc, argv, i, follow, follow_options) || parse_render_option(argc, argv, i)) {
+            continue;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = std::atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--beam-energy") == 0 && i + 1 < argc) {
+            beam_energy = std::atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = false;
+        } else {
+            run_number = std::atoi(argv[i]);
+        }
+    }
+    if (run_number < 0) {
+        std::cerr << "Usage: " << argv[0] << " <run number> [--follow] [-j threads] [--beam-energy GeV] [--no-cache]" << std::endl;
+        std::cerr << "  -j  threads for the event loop, 0 (default) for one per core, 1 for serial" << std::endl;
+        std::cerr << "  --beam-energy  start the fits from earlier runs near this energy, default from the run catalog" << std::endl;
+        std::cerr << "  --no-cache  neither read nor write the per-run feature cache (analyze_run with adc_sum also writes it)" << std::endl;
+        std::cerr << RENDER_USAGE;
+        std::cerr << FOLLOW_USAGE;
+        return 1;
+    }
+    // beam energy from the run catalog unless given
+    RunInfo run_info;
+    if (beam_energy <= 0 && find_run(run_number, run_info)) {
+        beam_energy = run_info.beam_energy;
+    }
+    gROOT->SetBatch(true);
+    bool ok = follow ? single_crystal_ADC_sum_follow(run_number, follow_options, n_threads, beam_energy)
+                     : single_crystal_ADC_sum_offline(run_number, n_threads, use_cache, beam_energy);
+    return ok ? 0 : 1;
+}
@@ -3,92 +3,266 @@
 1) Run the reconstruction software
 2) Create event displays
 3) Create the energy spectra plots
+
+ For one run or a whole campaign, e.g.
+    python fast_offline_production.py --run 61
+    python fast_offline_production.py --runs 56-107 --good --beam-energy 4 --workers 4 --io-slots 2
  '''
 
 import os
 import argparse
-import numpy as np
 import pandas as pd
+import run_catalog
 import sys
 import subprocess
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
 
-def main(args):
-    # define environment variables
-    DATA_PATH = '/Volumes/ProtzmanSSD/data/epic/eeemcal/DESY_FEB_2025/DESY_2025/data/beam'
-    OUTPUT_PATH = '/Volumes/ProtzmanSSD/data/epic/eeemcal/DESY_FEB_2025/prod'
-    RUNLOG_URL = 'https://docs.google.com/spreadsheets/d/100vYwQmm6yWk3cUcB_WvoXAw8JAoOyTnIgRnm21yAfs/export?format=csv&gid=526039506'
-    # WORKING_DIRECTORY = 'work'
-    WORKING_DIRECTORY = '/Users/tristan/dropbox/eeemcal_desy_feb_2025'
-    H2GDECODE_PATH = '/Users/tristan/epic/hgcroc/h2g_decode/build'
-    ROOT_PATH = '/opt/homebrew/bin/root'
+# define environment variables
+DATA_PATH = '/Volumes/ProtzmanSSD/data/epic/eeemcal/DESY_FEB_2025/DESY_2025/data/beam'
+OUTPUT_PATH = '/Volumes/ProtzmanSSD/data/epic/eeemcal/DESY_FEB_2025/prod'
+# WORKING_DIRECTORY = 'work'
+WORKING_DIRECTORY = '/Users/tristan/dropbox/eeemcal_desy_feb_2025'
+H2GDECODE_PATH = '/Users/tristan/epic/hgcroc/h2g_decode/build'
+ROOT_PATH = '/opt/homebrew/bin/root'
+BUILD_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'build')
+
+# Options of the analyses in pipelined mode: look for new events every
+# 2 s, and rewrite the online summaries every 30 s.  The run file is the
+# buffer between the decoder and the analyses; an analysis that falls
+# behind catches up 20000 events at a time, and one that is ahead waits
+# for the decoder to write more.
+FOLLOW_OPTIONS = ['--poll', 2, '--write-interval', 30, '--chunk', 20000]
+
+def run_pipelined(run_number, output_path, environment, decoder_command, decoder_cwd, *analysis_commands):
+    '''Decode the run and analyse it at the same time.
+
+    The analyses follow the run file while the decoder writes it, which needs
+    the decoder to write out the events tree as it goes (TTree::AutoSave or
+    FlushBaskets) rather than only when it closes the file.  Once the decoder
+    has finished successfully the run is marked complete with
+    <run file>.done; the analyses then process the remaining events and make
+    their final fits and plots.  If the decoder fails the analyses are
+    stopped, leaving only their online summaries.
+
+    Returns the exit codes of the decoder and of the analyses.
+    '''
+    run_file = os.path.join(output_path, f'Run{run_number:03}.root')
+    done_marker = run_file + '.done'
+    # a leftover file or marker of an earlier decoding would end the
+    # analyses before they saw the new events
+    for stale in (done_marker, run_file):
+        if os.path.exists(stale):
+            os.remove(stale)
+
+    print(f'Running the reconstruction software and the analyses on Run {run_number}')
+    decoder = subprocess.Popen(decoder_command, env=environment, cwd=decoder_cwd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    analyses = [subprocess.Popen(command, cwd=os.getcwd(), stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+                for command in analysis_commands]
+
+    if decoder.wait() == 0:
+        print(f'Reconstruction software finished on Run {run_number}')
+        open(done_marker, 'w').close()
+    else:
+        print(f'Reconstruction software failed on Run {run_number} with exit code {decoder.returncode}, stopping the analyses')
+        for analysis in analyses:
+            analysis.terminate()
+    return decoder.returncode, [analysis.wait() for analysis in analyses]
+
+def run_commands(commands):
+    '''Run the commands at the same time, returns their exit codes.'''
+    processes = [subprocess.Popen(command, cwd=os.getcwd(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                 for command in commands]
+    # communicate rather than wait, so a full pipe never blocks an analysis
+    for process in processes:
+        process.communicate()
+    return [process.returncode for process in processes]
+
+def analysis_command(args, run_number, analysis, options=(), macro_args=()):
+    '''Command line of an analysis of a run.
+
+    The analyses are built with `cmake -S . -B build && cmake --build build`.
+    options are passed to the executable, macro_args after the run number to
+    the ROOT macro.
+    '''
+    if args.interpreted:
+        macro_call = ', '.join([str(run_number)] + [str(arg) for arg in macro_args])
+        return [ROOT_PATH, '-q', '-b', '-x', '-l', f'{analysis}.cxx({macro_call})']
+    executable = os.path.join(BUILD_PATH, analysis)
+    if not os.path.exists(executable):
+        print(f'{executable} not found, build it with `cmake --build {BUILD_PATH}` or use --interpreted')
+        sys.exit(1)
+    return [executable, str(run_number)] + [str(option) for option in options]
+
+class Slots:
+    '''Limits of the batch production.
+
+    io bounds the jobs that stream whole run files through the disk: the
+    decoder and the copies of the results.  workers bounds the analysis jobs,
+    each of which runs `threads` threads, so workers * threads should not
+    exceed the cores of the node.
+    '''
+    def __init__(self, workers, io_slots, threads):
+        self.n_workers = workers
+        self.n_io = io_slots
+        self.workers = threading.Semaphore(workers)
+        self.io = threading.Semaphore(io_slots)
+        self.threads = threads
+
+def process_run(args, run_number, beam_energy, slots):
+    '''Decode and analyse one run, returns its line of the report.'''
+    report = {'run': run_number, 'beam_energy': beam_energy, 'status': 'ok', 'decode_s': 0.0, 'analysis_s': 0.0, 'copy_s': 0.0}
+    h2g_file_path = os.path.join(DATA_PATH, f'Run{run_number:03}.h2g')
+    if not os.path.exists(h2g_file_path):
+        print(f'Run {run_number} not found in data directory')
+        report['status'] = 'no data'
+        return report
+
+    environment = {'DATA_PATH': DATA_PATH, 'OUTPUT_PATH': OUTPUT_PATH}
+    decoder_command = [os.path.join(H2GDECODE_PATH, 'h2g_run'), str(run_number)]
+    # the plots are drawn from the results files by as many processes as
+    # the analysis has threads, or not at all with --no_plots
+    render_options = ['--no-plots'] if args.no_plots else ['--render-workers', slots.threads]
+    thread_options = ['-j', slots.threads] + render_options
+    single_crystal_options = thread_options + ['--beam-energy', beam_energy]
 
+    if args.pipelined:
+        # the decoder and the analyses run together, so the run holds both
+        # an I/O and a worker slot
+        with slots.io, slots.workers:
+            start = time.monotonic()
+            decoder_code, analysis_codes = run_pipelined(run_number, OUTPUT_PATH, environment, decoder_command, H2GDECODE_PATH,
+                analysis_command(args, run_number, 'single_crystal_ADC_sum', ['--follow'] + FOLLOW_OPTIONS + single_crystal_options),
+                analysis_command(args, run_number, 'adc_tot_correlation', ['--follow'] + FOLLOW_OPTIONS + thread_options))
+            report['analysis_s'] = time.monotonic() - start
+        if decoder_code != 0:
+            report['status'] = f'decode failed ({decoder_code})'
+            return report
+        # the event index, timing and cluster modules have no online mode,
+        # so they read the complete run file in one more pass
+        with slots.workers:
+            start = time.monotonic()
+            analysis_codes += run_commands([
+                analysis_command(args, run_number, 'analyze_run', ['--modules', 'index,timing,cluster'] + thread_options)])
+            report['analysis_s'] += time.monotonic() - start
+    else:
+        # run the reconstruction software
+        if not args.skip_decode:
+            with slots.io:
+                print(f'Running the reconstruction software on Run {run_number}')
+                start = time.monotonic()
+                decoder = subprocess.run(decoder_command, env=environment, cwd=H2GDECODE_PATH, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                report['decode_s'] = time.monotonic() - start
+            if decoder.returncode != 0:
+                print(f'Reconstruction software failed on Run {run_number} with exit code {decoder.returncode}')
+                report['status'] = f'decode failed ({decoder.returncode})'
+                return report
+            print(f'Reconstruction software finished on Run {run_number}')
+
+        # create the event displays
+        # print(f'Creating event displays for Run {run_number}')
+        # command = [ROOT_PATH, '-q', '-b', '-x', '-l', f'event_display.cxx({run_number})']
+        # command = [ROOT_PATH, '-q', '-b', '-x', '-l', f'event_display_tot.cxx({run_number})']
+
+        with slots.workers:
+            print(f'Creating energy spectra and TOT and ADC correlation plots for Run {run_number}')
+            start = time.monotonic()
+            if args.interpreted:
+                analysis_codes = run_commands([
+                    analysis_command(args, run_number, 'single_crystal_ADC_sum', macro_args=[slots.threads, 'true', beam_energy]),
+                    analysis_command(args, run_number, 'adc_tot_correlation', macro_args=[slots.threads])])
+            else:
+                # both analyses in one pass over the run file
+                analysis_codes = run_commands([
+                    analysis_command(args, run_number, 'analyze_run', ['--modules', 'adc_sum,adc_tot,index,timing,cluster'] + single_crystal_options)])
+            report['analysis_s'] = time.monotonic() - start
+
+    failed = [code for code in analysis_codes if code != 0]
+    if failed:
+        report['status'] = f'analysis failed ({failed[0]})'
+
+    print(f'Done processing Run {run_number}, moving files...')
+    with slots.io:
+        start = time.monotonic()
+        os.makedirs(f'{WORKING_DIRECTORY}/run{run_number}', exist_ok=True)
+        os.system(f'mv output/Run{run_number:03}*.pdf {WORKING_DIRECTORY}/run{run_number}')
+        os.system(f'cp {OUTPUT_PATH}/Run{run_number:03}.root {WORKING_DIRECTORY}/run{run_number}')
+        report['copy_s'] = time.monotonic() - start
+    return report
+
+def select_runs(args, catalog):
+    '''Runs to process with their beam energies, in run order.'''
+    ranges = []
+    if args.run is not None:
+        ranges.append((args.run, args.run))
+    if args.runs:
+        ranges.extend(run_catalog.parse_run_ranges(args.runs))
+    # check that single requested runs exist in the runlog
+    for first, last in ranges:
+        if first == last and not run_catalog.run_exists(catalog, first):
+            print(f'Run {first} not found in runlog')
+    # beam energy of the run in GeV, the fits start from earlier runs near it
+    return run_catalog.select_runs(catalog, ranges, args.good, args.beam_energy)
+
+def write_report(reports, path):
+    report = pd.DataFrame(reports, columns=['run', 'beam_energy', 'status', 'decode_s', 'analysis_s', 'copy_s'])
+    print(report.to_string(index=False, float_format='%.1f'))
+    report.to_csv(path, sep='\t', index=False, float_format='%.1f')
+    print(f'Report written to {path}')
+
+def main(args):
     # parse the arguments
     parser = argparse.ArgumentParser(description='Run the fast offline production')
     parser.add_argument('--run', type=int, help='Run number to process')
+    parser.add_argument('--runs', help='Run ranges to process, e.g. 56-107,110')
+    parser.add_argument('--good', action='store_true', help='Only the runs marked GOOD in the runlog')
+    parser.add_argument('--beam-energy', type=float, help='Only the runs at this beam energy (GeV)')
+    parser.add_argument('--workers', type=int, default=1, help='Runs analysed at the same time')
+    parser.add_argument('--io-slots', type=int, default=1, help='Runs decoded or copied at the same time')
+    parser.add_argument('--threads', type=int, default=0, help='Threads per analysis, default the cores divided by --workers')
+    parser.add_argument('--offline', action='store_true', help='Use the local run catalog without trying to update it')
+    parser.add_argument('--report', default='output/production_report.tsv', help='Per run status and timings of a batch')
+    parser.add_argument('--no_plots', action='store_true', help='Only write the fit results, draw the PDFs later with build/render_plots')
     parser.add_argument('--skip_decode', action='store_true', help='Skip the decoding step')
+    parser.add_argument('--interpreted', action='store_true', help='Run the analyses as ROOT macros instead of the compiled executables')
+    parser.add_argument('--pipelined', action='store_true', help='Run the analyses on the run file while the decoder writes it; the event index, timing and cluster outputs follow in one analyze_run pass once the run is decoded')
 
     args = parser.parse_args()
-    run_number = args.run
-    if run_number is None:
+    if args.run is None and args.runs is None:
         print('Please provide a run number')
         return
+    if args.pipelined and (args.interpreted or args.skip_decode):
+        print('--pipelined needs the compiled analyses and the decoder, it cannot be combined with --interpreted or --skip_decode')
+        return
+    if args.no_plots and args.interpreted:
+        print('--no_plots needs the compiled analyses, the ROOT macros always draw their plots')
+        return
+    workers = max(1, args.workers)
+    threads = args.threads if args.threads > 0 else max(1, (os.cpu_count() or 1) // workers)
+    slots = Slots(workers, max(1, args.io_slots), threads)
 
     # create the working directory
     os.makedirs(WORKING_DIRECTORY, exist_ok=True)
+    os.makedirs('output', exist_ok=True)
 
-    # download the runlog
-    runlog = pd.read_csv(RUNLOG_URL)
-
-    # check that the run exists in both the runlog and the data directory
-    if run_number not in runlog['Run Number'].values:
-        print(f'Run {run_number} not found in runlog')
+    # the run log, from the local catalog
+    catalog = run_catalog.open_catalog(offline=args.offline)
+    runs = select_runs(args, catalog)
+    if not runs:
+        print('No runs selected')
         return
-    h2g_file_path = os.path.join(DATA_PATH, f'Run{run_number:03}.h2g')
-    if not os.path.exists(h2g_file_path):
-        print(f'Run {run_number} not found in data directory')
-        return
-    
-    # run the reconstruction software
-    if not args.skip_decode:
-        print(f'Running the reconstruction software on Run {run_number}')
-        environment = {'DATA_PATH': DATA_PATH, 'OUTPUT_PATH': OUTPUT_PATH}
-        command = [os.path.join(H2GDECODE_PATH, 'h2g_run'), str(run_number)]
-        subprocess.run(command, env=environment, cwd=H2GDECODE_PATH, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-        print('Reconstruction software finished')
-
-    # create the event displays
-    # print(f'Creating event displays for Run {run_number}')
-    # command = [ROOT_PATH, '-q', '-b', '-x', '-l', f'event_display.cxx({run_number})']
-    # p1 = subprocess.Popen(command, cwd=os.getcwd(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    # command = [ROOT_PATH, '-q', '-b', '-x', '-l', f'event_display_tot.cxx({run_number})']
-    # p2 = subprocess.Popen(command, cwd=os.getcwd(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-
-    # create the energy spectra plots
-    print(f'Creating energy spectra plots for Run {run_number}')
-    command = [ROOT_PATH, '-q', '-b', '-x', '-l', f'single_crystal_ADC_sum.cxx({run_number})']
-    p3 = subprocess.Popen(command, cwd=os.getcwd(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-
-    #create TOT and ADC correlation plots
-    print(f'Creating TOT and ADC correlation plots for Run {run_number}')
-    command = [ROOT_PATH, '-q', '-b', '-x', '-l', f'adc_tot_correlation.cxx({run_number})']
-    p4 = subprocess.Popen(command, cwd=os.getcwd(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-
-    # wait for the processes to finish
-    # p1.wait()
-    # p2.wait()
-    p3.wait()
-    p4.wait()
-
-    print('Done processing, moving files...')
-    os.makedirs(f'{WORKING_DIRECTORY}/run{run_number}', exist_ok=True)
-    os.system(f'mv output/Run{run_number:03}*.pdf {WORKING_DIRECTORY}/run{run_number}')
-    os.system(f'cp {OUTPUT_PATH}/Run{run_number:03}.root {WORKING_DIRECTORY}/run{run_number}')
-
-    print('Fast offline production finished')
-    
+    print(f'Processing {len(runs)} runs with {slots.n_workers} workers of {threads} threads and {slots.n_io} I/O slots')
 
+    # One thread per run in flight.  The slots decide what actually runs, so
+    # more than workers + io_slots threads would only wait.
+    with ThreadPoolExecutor(max_workers=min(len(runs), slots.n_workers + slots.n_io)) as executor:
+        reports = list(executor.map(lambda run: process_run(args, run[0], run[1], slots), runs))
 
+    if len(runs) > 1:
+        write_report(reports, args.report)
+    print('Fast offline production finished')
 
 
 if __name__ == '__main__':
-    main(sys.argv)
\ No newline at end of file
+    main(sys.argv)
@@ -1,7 +1,7 @@
-// Idea: Load each run, calculate the sum of the max sample in the
-// central crystal.  When the central crystal is best centered, it 
-// should have the largest sum.  We might need to incorperate the 
-// left and right crystal too, let's see if we can make it easy first 
+// Beam position of each scan run from the per-event positions of the
+// event index: the log weighted centroid over the crystals, or over the
+// SiPMs of the leading crystal, histogrammed for every run and compared
+// with the table position.  Set `sipm` to use the SiPM centroid.
 
 #include <TROOT.h>
 #include <TH1.h>
@@ -14,24 +14,24 @@
 #include <TGraph.h>
 #include <TGraphErrors.h>
 #include <TF1.h>
+#include <TSystem.h>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
 
-const int center_fpga = 1;
-const int center_asic = 0;
-const int center_connector = 0;
+R__LOAD_LIBRARY(build/libeeemcal)
 
-int eeemcal_16i_channel_a_map[16] = { 0,  1,  2,  3,  4,  5,  6,  7,
-                                      9, 10, 11, 12, 13, 14, 15, 16};
-
-const int NUM_SAMPLES = 20;
+#include "src/eeemcal_analyses.h"
+#include "src/eeemcal_event_index.h"
 
 void position_scan() {
     int mode = 0;   // 0 horizontal, 1 vertical
+    bool sipm = false;  // centroid over the SiPMs of the leading crystal, assumed layout, see sipm_grid_slot
     gStyle->SetOptStat(0);
     std::vector<TH1*> position_hists;
+    std::vector<TF1*> position_fits;
     std::vector<int> h_positions = {-4, -2, 0, 2, 4};
     std::vector<int> h_runs = {39, 38, 37, 40, 41};
 
@@ -57,50 +57,36 @@ void position_scan() {
 
     int i = 0;
     for (auto run : runs) {
-        auto path = getenv("OUTPUT_PATH");
-        TFile *file = new TFile(Form("%s/run%03d.root", path, run));
-        if (!file) {
-            std::cerr << "Error opening file" << std::endl;
-            return;
+        // The positions come from the event index of the run, made here
+        // with the fused driver if the production did not
+        if (gSystem->AccessPathName(event_index_path(run).c_str())) {
+            auto module = make_event_index_module(run);
+            if (!run_analysis_modules(run, {module.get()}, 0)) {
+                return;
+            }
         }
-
-        TTree *tree;
-        file->GetObject("events", tree);
-        if (!tree) {
-            std::cerr << "Error getting tree from file" << std::endl;
+        std::vector<EventKey> keys;
+        if (!read_event_index(run, keys)) {
             return;
         }
-
-        uint waveform[576][NUM_SAMPLES];
-        uint tot[576][NUM_SAMPLES];
-        tree->SetBranchAddress("adc", &waveform);
-        tree->SetBranchAddress("tot", &tot);
-
-        TH1D *adc_sum_hist = new TH1D(Form("adc_sum_hist_run%03d", run), "ADC Sum;ADC;Counts", 500, 0, 8000);
-        position_hists.push_back(adc_sum_hist);
-
-        int n_events = tree->GetEntries();
-        for (int event = 0; event < n_events; event++) {
-            tree->GetEntry(event);
-            int adc_sum = 0;
-            for (int channel = 0; channel < 16; channel++) {
-                double max_adc = 0;
-                int actual_channel = eeemcal_16i_channel_a_map[center_connector] + center_fpga*144 + center_asic*72;
-                for (int sample = 0; sample < NUM_SAMPLES; sample++) {
-                    int sample_adc = waveform[actual_channel][sample] - waveform[actual_channel][0];
-                    if (sample_adc > max_adc) {
-                        max_adc = sample_adc;
-                    }
-                }
-                adc_sum += max_adc;
-            }
-            if (adc_sum > 0) {
-                adc_sum_hist->Fill(adc_sum);
+        TH1D *position_hist = new TH1D(Form("position_hist_run%03d", run), ";Position (mm);Events", 200, -50, 50);
+        position_hist->SetDirectory(nullptr);
+        for (const EventKey &key : keys) {
+            if (key.leading_sum <= 0) {
+                continue;
             }
+            float x = sipm ? key.x_sipm : key.x;
+            float y = sipm ? key.y_sipm : key.y;
+            position_hist->Fill(mode == 0 ? x : y);
         }
-        TF1 *fit = new TF1("fit", "gaus", 3500, 5000);
-        // TF1 *fit = new TF1("fit", "gaus", 200, 325);
-        adc_sum_hist->Fit(fit, "QR");
+        position_hists.push_back(position_hist);
+
+        // Core of the distribution, the tails are showers leaking out
+        double peak = position_hist->GetBinCenter(position_hist->GetMaximumBin());
+        double rms = position_hist->GetRMS();
+        TF1 *fit = new TF1(Form("fit_run%03d", run), "gaus", peak - 1.5 * rms, peak + 1.5 * rms);
+        position_hist->Fit(fit, "QR");
+        position_fits.push_back(fit);
         mean_vs_position->SetPoint(i, positions[i], fit->GetParameter(1));
         mean_vs_position->SetPointError(i, 0, fit->GetParError(1));
         i++;
@@ -112,44 +98,42 @@ void position_scan() {
         c->cd(i+1);
         position_hists[i]->SetTitle(Form("%s Position: %d", axis.c_str(), positions[i]));
         position_hists[i]->Draw();
-        double mean = position_hists[i]->GetFunction("fit")->GetParameter(1);
-        double stddev = position_hists[i]->GetFunction("fit")->GetParameter(2);
+        double mean = position_fits[i]->GetParameter(1);
+        double stddev = position_fits[i]->GetParameter(2);
         TLatex latex;
         latex.SetNDC();
         latex.SetTextSize(0.04);
-        latex.DrawLatex(0.20, 0.85, Form("Mean = %.2f", mean));
-        latex.DrawLatex(0.20, 0.80, Form("StdDev = %.2f", stddev));
-        latex.DrawLatex(0.20, 0.75, Form("StdDev/Mean = %.2f", stddev/mean));
+        latex.DrawLatex(0.20, 0.85, Form("Mean = %.2f mm", mean));
+        latex.DrawLatex(0.20, 0.80, Form("StdDev = %.2f mm", stddev));
     }
-    c->SaveAs("adc_sum_hist.png");
-    // return;
-
-    for (int i = 0; i < position_hists.size(); i++) {
-    }
-
+    c->SaveAs("position_hist.png");
 
     float min = *std::min_element(positions.begin(), positions.end());
     float max = *std::max_element(positions.begin(), positions.end());
-    
-    TF1 *fit = new TF1("fit", "gaus", min, max);
-    
+
+    // Reconstructed against table position: the offset is where the table
+    // puts the beam on the center of the array, the slope the scale of the
+    // centroid, below 1 as log weights pull toward the crystal centers
+    TF1 *fit = new TF1("fit", "pol1", min, max);
+
     mean_vs_position->Fit(fit, "QR");
     
     c = new TCanvas("c2", "c2", 1000, 800);
-    mean_vs_position->SetTitle(Form("Mean vs %s Position;%s Position (mm);Mean (ADC)", axis.c_str(), axis.c_str()));
-    // mean_vs_position->SetMinimum(3500);
-    // mean_vs_position->SetMaximum(6000);
+    mean_vs_position->SetTitle(Form("Reconstructed vs %s Position;%s Table Position (mm);Reconstructed Position (mm)",
+                                    axis.c_str(), axis.c_str()));
     mean_vs_position->SetMarkerStyle(20);
     mean_vs_position->Draw("AP");
 
     TLatex latex;
     latex.SetNDC();
     latex.SetTextSize(0.03);
-    double a = fit->GetParameter(2);
-    double ea = fit->GetParError(2);
-    double b = fit->GetParameter(1);
-    double eb = fit->GetParError(1);
-    latex.DrawLatexNDC(0.15, 0.85, Form("Center of fit: %.03f#pm %.03f mm", fit->GetParameter(1), fit->GetParError(1)));
+    double offset = fit->GetParameter(0);
+    double slope = fit->GetParameter(1);
+    latex.DrawLatexNDC(0.15, 0.85, Form("Offset: %.03f#pm %.03f mm", offset, fit->GetParError(0)));
+    latex.DrawLatexNDC(0.15, 0.80, Form("Slope: %.03f#pm %.03f", slope, fit->GetParError(1)));
+    if (slope != 0) {
+        latex.DrawLatexNDC(0.15, 0.75, Form("Centered at table position %.03f mm", -offset / slope));
+    }
     if (mode == 0) {
         c->SaveAs("horizontal_position.png");
     } else if (mode == 1) {
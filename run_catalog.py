@@ -0,0 +1,156 @@
+'''
+ Local catalog of the run log.
+
+ The run log spreadsheet is downloaded into an SQLite file,
+ output/run_catalog.sqlite, indexed by run number, beam energy, beam
+ position and quality flag.  The production scripts and the C++ tools
+ (src/eeemcal_run_catalog.h) query the file; the download is only tried
+ when the catalog is older than SYNC_AGE_SECONDS, and everything keeps
+ working offline from the last copy.
+
+    python run_catalog.py sync
+    python run_catalog.py query --runs 56-107 --good --beam-energy 4
+ '''
+
+import argparse
+import io
+import json
+import os
+import sqlite3
+import sys
+import time
+import urllib.request
+
+import pandas as pd
+
+RUNLOG_URL = 'https://docs.google.com/spreadsheets/d/100vYwQmm6yWk3cUcB_WvoXAw8JAoOyTnIgRnm21yAfs/export?format=csv&gid=526039506'
+CATALOG_PATH = 'output/run_catalog.sqlite'
+SYNC_AGE_SECONDS = 600
+SYNC_TIMEOUT_SECONDS = 5
+
+SCHEMA = '''
+CREATE TABLE IF NOT EXISTS runs (
+    run INTEGER PRIMARY KEY,
+    beam_energy REAL,          -- GeV
+    position_x REAL,           -- horizontal beam position (mm)
+    position_y REAL,           -- vertical beam position (mm)
+    good INTEGER NOT NULL,     -- 1 if marked GOOD
+    runlog TEXT                -- the whole run log row, as JSON
+);
+CREATE INDEX IF NOT EXISTS runs_beam_energy ON runs (beam_energy);
+CREATE INDEX IF NOT EXISTS runs_good ON runs (good, beam_energy);
+CREATE INDEX IF NOT EXISTS runs_position ON runs (position_x, position_y);
+CREATE TABLE IF NOT EXISTS catalog (key TEXT PRIMARY KEY, value TEXT);
+'''
+
+def find_column(columns, *keywords):
+    '''First run log column whose name contains all keywords, ignoring case.'''
+    for column in columns:
+        if all(keyword in column.lower() for keyword in keywords):
+            return column
+    return None
+
+def number_or_none(value):
+    number = pd.to_numeric(value, errors='coerce')
+    return None if pd.isna(number) else float(number)
+
+def sync(connection, url=RUNLOG_URL):
+    '''Replace the catalog by the current run log, returns False if it is unreachable.'''
+    try:
+        with urllib.request.urlopen(url, timeout=SYNC_TIMEOUT_SECONDS) as response:
+            runlog = pd.read_csv(io.BytesIO(response.read()))
+    except Exception as error:
+        print(f'Run log not reachable ({error}), using the local catalog')
+        return False
+
+    columns = list(runlog.columns)
+    position_x = find_column(columns, 'horizontal') or find_column(columns, 'position', 'x')
+    position_y = find_column(columns, 'vertical') or find_column(columns, 'position', 'y')
+    rows = []
+    for record in runlog.to_dict('records'):
+        run = number_or_none(record.get('Run Number'))
+        if run is None:
+            continue
+        rows.append((int(run),
+                     number_or_none(record.get('Beam Energy')),
+                     number_or_none(record.get(position_x)) if position_x else None,
+                     number_or_none(record.get(position_y)) if position_y else None,
+                     int(record.get('Good') == 'GOOD'),
+                     json.dumps({key: (None if pd.isna(value) else value) for key, value in record.items()}, default=str)))
+    with connection:
+        connection.execute('DELETE FROM runs')
+        connection.executemany('INSERT OR REPLACE INTO runs VALUES (?, ?, ?, ?, ?, ?)', rows)
+        connection.execute("INSERT OR REPLACE INTO catalog VALUES ('synced', ?)", (str(time.time()),))
+    return True
+
+def connect(path=CATALOG_PATH):
+    os.makedirs(os.path.dirname(path) or '.', exist_ok=True)
+    connection = sqlite3.connect(path)
+    connection.executescript(SCHEMA)
+    return connection
+
+def open_catalog(path=CATALOG_PATH, offline=False, force_sync=False):
+    '''Open the catalog, syncing it first if it is stale and offline is not set.'''
+    connection = connect(path)
+    synced = connection.execute("SELECT value FROM catalog WHERE key = 'synced'").fetchone()
+    stale = synced is None or time.time() - float(synced[0]) > SYNC_AGE_SECONDS
+    if force_sync or (stale and not offline):
+        sync(connection)
+    if connection.execute('SELECT COUNT(*) FROM runs').fetchone()[0] == 0:
+        print(f'The run catalog {path} is empty, run `python run_catalog.py sync` with network access')
+    return connection
+
+def parse_run_ranges(text):
+    '''"56-60,62" -> [(56, 60), (62, 62)]'''
+    ranges = []
+    for part in text.split(','):
+        first, _, last = part.partition('-')
+        ranges.append((int(first), int(last or first)))
+    return ranges
+
+def select_runs(connection, ranges=None, good=False, beam_energy=None):
+    '''(run, beam energy) of the matching runs in run order, beam energy 0 if unknown.
+
+    ranges is a list of (first, last) run numbers, None for all runs.
+    '''
+    conditions = []
+    parameters = []
+    if ranges is not None:
+        conditions.append('(' + ' OR '.join(['run BETWEEN ? AND ?'] * len(ranges)) + ')' if ranges else '0')
+        parameters.extend(run for run_range in ranges for run in run_range)
+    if good:
+        conditions.append('good = 1')
+    if beam_energy is not None:
+        conditions.append('beam_energy BETWEEN ? AND ?')
+        parameters.extend([beam_energy - 1e-6, beam_energy + 1e-6])
+    query = 'SELECT run, COALESCE(beam_energy, 0) FROM runs'
+    if conditions:
+        query += ' WHERE ' + ' AND '.join(conditions)
+    return connection.execute(query + ' ORDER BY run', parameters).fetchall()
+
+def run_exists(connection, run):
+    return connection.execute('SELECT 1 FROM runs WHERE run = ?', (run,)).fetchone() is not None
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Local catalog of the run log')
+    parser.add_argument('command', choices=['sync', 'query'])
+    parser.add_argument('--catalog', default=CATALOG_PATH, help='Catalog file')
+    parser.add_argument('--runs', help='Run ranges, e.g. 56-107,110')
+    parser.add_argument('--good', action='store_true', help='Only the runs marked GOOD')
+    parser.add_argument('--beam-energy', type=float, help='Only the runs at this beam energy (GeV)')
+    args = parser.parse_args(argv[1:])
+
+    if args.command == 'sync':
+        connection = connect(args.catalog)
+        if not sync(connection):
+            return 1
+        print(f'{connection.execute("SELECT COUNT(*) FROM runs").fetchone()[0]} runs in {args.catalog}')
+        return 0
+    connection = open_catalog(args.catalog, offline=True)
+    ranges = parse_run_ranges(args.runs) if args.runs else None
+    for run, beam_energy in select_runs(connection, ranges, args.good, args.beam_energy):
+        print(run, beam_energy)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,413 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_calibration.h"
+#include "eeemcal_event_loop.h"
+#include "eeemcal_features.h"
+#include "eeemcal_fit.h"
+#include "eeemcal_follow.h"
+#include "eeemcal_histogram_bank.h"
+#include "eeemcal_hits.h"
+#include "eeemcal_mapping.h"
+#include "eeemcal_reader.h"
+#include "eeemcal_render.h"
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TCanvas.h>
+#include <TPad.h>
+#include <TH1F.h>
+#include <TH2F.h>
+#include <TError.h>
+#include <TStyle.h>
+#include <TColor.h>
+#include <TLatex.h>
+#include <TF1.h>
+#include <TLine.h>
+#include <TParameter.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// One histogram per mapped channel, filled as a bank and only turned into
+// TH2Fs for the fits and plots
+struct AdcTotHistograms {
+    HistogramBank2D bank;
+    Long64_t n_events = 0;
+
+    AdcTotHistograms(const ChannelMap &channel_map);
+    void fill(const WaveformFeatures &features, const HitList &hits);
+    void add(const AdcTotHistograms &other);
+    // The bank and counters in an accumulator file
+    void write() const;
+    bool add_from(TDirectory *dir);
+};
+
+AdcTotHistograms::AdcTotHistograms(const ChannelMap &channel_map)
+    : bank(channel_map.n_mapped, 1024/8, 0, 1024, 4096/32, 0, 4096) {}
+
+// Max ADC vs max ToT of the channels above the ToT threshold whose ADC at the
+// ToT sample is not saturated.  Every channel with a ToT is a hit.
+void AdcTotHistograms::fill(const WaveformFeatures &features, const HitList &hits) {
+    int hit_ids[MAX_MAPPED_CHANNELS];
+    double hit_adc[MAX_MAPPED_CHANNELS];
+    double hit_tot[MAX_MAPPED_CHANNELS];
+    int n_hits = 0;
+    for (const Hit &hit : hits) {
+        int i = hit.index;
+        int tot_val = hit.tot;
+        int adc_val = hit.amplitude;
+        if (tot_val > 5) {
+            if (adc_val > 200 && features.adc_at_tot[i] < 1000) {
+                hit_ids[n_hits] = i;
+                hit_adc[n_hits] = adc_val;
+                hit_tot[n_hits] = tot_val;
+                n_hits++;
+            }
+        }
+    }
+    bank.fill(hit_ids, hit_adc, hit_tot, n_hits);
+    n_events++;
+}
+
+void AdcTotHistograms::add(const AdcTotHistograms &other) {
+    bank.add(other.bank);
+    n_events += other.n_events;
+}
+
+void AdcTotHistograms::write() const {
+    bank.write("adc_tot");
+    TParameter<Long64_t>("n_events", n_events).Write();
+}
+
+bool AdcTotHistograms::add_from(TDirectory *dir) {
+    TParameter<Long64_t> *events = nullptr;
+    dir->GetObject("n_events", events);
+    if (!events) {
+        std::cerr << "Error getting n_events from " << dir->GetName() << std::endl;
+        return false;
+    }
+    n_events += events->GetVal();
+    delete events;
+    return bank.add_from(dir, "adc_tot");
+}
+
+// Indexed by channel like before, null for the unmapped ones
+static std::vector<TH2F*> make_adc_tot_hists(const HistogramBank2D &bank, const ChannelMap &channel_map) {
+    std::vector<TH2F*> hists(576, nullptr);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        int channel = channel_map.channel[i];
+        hists[channel] = bank.to_th2(i, Form("adc_tot_ch%d", channel), "ADC vs TOT;Max ADC;Max TOT");
+    }
+    return hists;
+}
+
+// Accumulator file of a run or of merged runs, see merge_adc_tot_runs
+static bool write_adc_tot_accumulators(const AdcTotHistograms &totals, const OutputName &output) {
+    std::string path = accumulator_path(output.file, "adc_tot");
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+    totals.write();
+    file->Close();
+    return true;
+}
+
+// Range of the linear fit of the ToT vs ADC correlation above the ToT threshold
+static const int ADC_TOT_FIT_START = 700;
+static const int ADC_TOT_FIT_END = 900;
+
+// Linear fits and calibration constants of the filled histograms of a run.
+// The histograms with their fits go to the results file, from which the
+// plots are drawn.  Returns false if the accumulator or results file cannot
+// be written.
+static bool fit_adc_tot(const AdcTotHistograms &totals, const ChannelMap &channel_map, const OutputName &output, int n_threads) {
+    bool ok = write_adc_tot_accumulators(totals, output);
+    std::vector<TH2F*> hists = make_adc_tot_hists(totals.bank, channel_map);
+    
+    std::vector<float> slopes(576);
+    std::vector<float> slope_errors(576);
+    std::vector<float> intercepts(576);
+    std::vector<float> intercept_errors(576);
+    for (int i = 0; i < 576; i++) {
+        slopes[i] = 0;
+        slope_errors[i] = 0;
+    }
+
+    // All channels at once on the worker threads
+    std::vector<FitTask> fit_tasks;
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        FitTask task;
+        task.hist = hists[channel_map.channel[i]];
+        task.make_function = [=](const char *name) {
+            return new TF1(name, [](double *x, double *par) { return par[0] * x[0] + par[1]; },
+                           ADC_TOT_FIT_START, ADC_TOT_FIT_END, 2, 1, TF1::EAddToList::kNo);
+        };
+        fit_tasks.push_back(task);
+    }
+    std::vector<FitResult> fits = run_fits(fit_tasks, n_threads);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        int channel = channel_map.channel[i];
+        TF1 *fit = fits[i].function;
+        slopes[channel] = fit->GetParameter(0);
+        slope_errors[channel] = fit->GetParError(0);
+        intercepts[channel] = fit->GetParameter(1);
+        intercept_errors[channel] = fit->GetParError(1);
+    }
+
+    // Write slopes and intercepts to root file
+    auto slopes_histogram = new TH1F("adc_tot_slope", "Slopes;Channel;Slope", 576, 0, 576);
+    auto intercepts_histogram = new TH1F("adc_tot_intercept", "Intercepts;Channel;Intercept", 576, 0, 576);
+    for (int i = 0; i < 576; i++) {
+        slopes_histogram->SetBinContent(i + FIRST_CHANNEL_BIN, slopes[i]);
+        slopes_histogram->SetBinError(i + FIRST_CHANNEL_BIN, slope_errors[i]);
+        intercepts_histogram->SetBinContent(i + FIRST_CHANNEL_BIN, intercepts[i]);
+        intercepts_histogram->SetBinError(i + FIRST_CHANNEL_BIN, intercept_errors[i]);
+    }
+    TFile *output_file = new TFile(Form("output/%s_adc_tot_correlation.root.new", output.file.c_str()), "RECREATE");
+    slopes_histogram->Write();
+    intercepts_histogram->Write();
+    TParameter<int>("first_channel_bin", FIRST_CHANNEL_BIN).Write();
+    output_file->Close();
+
+    // Write the results for the plots
+    std::string path = results_path(output.file, "adc_tot");
+    std::unique_ptr<TFile> results_file(TFile::Open(path.c_str(), "RECREATE"));
+    if (!results_file || results_file->IsZombie()) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+    for (auto hist : hists) {
+        if (hist) {
+            hist->Write();
+        }
+    }
+    results_file->Close();
+
+    render_plots(adc_tot_render_jobs(output.file));
+    return ok;
+}
+
+// One page per crystal with the correlation and fit of each SiPM
+static void draw_adc_tot_page(TDirectory *dir, const ChannelMap &channel_map, int crystal, TCanvas *c) {
+    c->cd();
+    auto label = new TLatex();
+    label->SetNDC();
+    label->SetTextSize(0.05);
+    label->DrawLatex(0.05, 0.9, Form("Crystal %d ADC TOT Correlation", crystal));
+
+
+    auto pad = new TPad("pad", "pad", 0.05, 0.05, 0.95, 0.85);
+    pad->Draw();
+    // Add text to the top of the pad with the run and event number
+    pad->cd();
+    pad->Divide(4, 4, 0.000, 0.000);
+
+    for (int sipm = 0; sipm < channel_map.n_sipms; sipm++) {
+        pad->cd(sipm+1);
+        int channel = channel_map.channel_of(crystal, sipm);
+        TH2F *hist = nullptr;
+        dir->GetObject(Form("adc_tot_ch%d", channel), hist);
+        if (!hist) {
+            continue;
+        }
+        TF1 *fit = hist->GetFunction("fit");
+        hist->Draw("COLZ");
+        TLatex latex;
+        latex.SetNDC();
+        latex.SetTextSize(0.03);
+        latex.DrawLatex(0.12, 0.85, Form("Channel %d", channel));
+        if (fit) {
+            latex.DrawLatex(0.12, 0.81, Form("Slope: %.2f#pm%.4f", fit->GetParameter(0), fit->GetParError(0)));
+            latex.DrawLatex(0.12, 0.77, Form("Intercept: %.2f#pm%.4f", fit->GetParameter(1), fit->GetParError(1)));
+        }
+        TLine *line1 = new TLine(ADC_TOT_FIT_START, 0, ADC_TOT_FIT_START, hist->GetYaxis()->GetXmax());
+        line1->SetLineColor(kRed);
+        line1->SetLineStyle(2);
+        line1->Draw();
+
+        TLine *line2 = new TLine(ADC_TOT_FIT_END, 0, ADC_TOT_FIT_END, hist->GetYaxis()->GetXmax());
+        line2->SetLineColor(kRed);
+        line2->SetLineStyle(2);
+        line2->Draw();
+    }
+    // latex.DrawLatex(0.12, 0.77, Form("Fit #chi^{2}/NDF: %.2f", fit->GetChisquare()/fit->GetNDF()));
+}
+
+// Pages [first, last), one per crystal, of the document of a results file
+static bool render_adc_tot_pages(const std::string &results_file, int first, int last, const std::string &pdf) {
+    std::unique_ptr<TFile> file(TFile::Open(results_file.c_str()));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening " << results_file << std::endl;
+        return false;
+    }
+    const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+    gStyle->SetOptStat(0);
+    for (int crystal = first; crystal < last; crystal++) {
+        std::unique_ptr<TCanvas> canvas(new TCanvas(Form("adc_tot_page_%02d", crystal), "c", 1600, 900));
+        draw_adc_tot_page(file.get(), channel_map, crystal, canvas.get());
+        save_page(canvas.get(), pdf, crystal, first, last);
+    }
+    return true;
+}
+
+std::vector<RenderJob> adc_tot_render_jobs(const std::string &output_file) {
+    std::string results_file = results_path(output_file, "adc_tot");
+    return {
+        {Form("output/%s_adc_tot_correlation.pdf", output_file.c_str()), 25,
+         [=](int first, int last, const std::string &pdf) { return render_adc_tot_pages(results_file, first, last, pdf); }},
+    };
+}
+
+bool adc_tot_correlation_offline(int run, int n_threads) {
+    gErrorIgnoreLevel = kWarning;
+    gStyle->SetOptStat(0);
+    // Read in the waveforms
+    auto path = getenv("OUTPUT_PATH");
+    TFile *file = new TFile(Form("%s/Run%03d.root", path, run));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening file" << std::endl;
+        return false;
+    }
+
+    // Get the tree from the file
+    TTree *tree = nullptr;
+    file->GetObject("events", tree);
+    if (!tree) {
+        std::cerr << "Error getting tree from file" << std::endl;
+        return false;
+    }
+
+    EventReader reader(tree, BRANCH_ADC | BRANCH_TOT);
+    if (!reader.is_valid()) {
+        return false;
+    }
+
+    const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+    AdcTotHistograms totals(channel_map);
+    WaveformFeatures features;
+    PedestalTracker pedestals;
+    HitList hits;
+    int n_events = reader.n_entries();
+    for (int event = 0; event < n_events; event++) {
+        if (!pedestals.read(reader, event, channel_map)) {
+            std::cerr << "Error reading event " << event << std::endl;
+            return false;
+        }
+        extract_features(reader.adc(), reader.tot(), nullptr, channel_map, pedestals.snapshot(), features);
+        find_hits(features, hits);
+        totals.fill(features, hits);
+    }
+
+    return fit_adc_tot(totals, channel_map, run_output_name(run), n_threads);
+}
+
+
+bool adc_tot_correlation_follow(int run, const FollowOptions &options, int n_threads) {
+    auto path = getenv("OUTPUT_PATH");
+    const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+    AdcTotHistograms totals(channel_map);
+    WaveformFeatures features;
+    PedestalTracker pedestals;
+    HitList hits;
+    FollowStatus status = follow_run(Form("%s/Run%03d.root", path, run), BRANCH_ADC | BRANCH_TOT, options,
+        [&](EventReader &reader, Long64_t first, Long64_t last) {
+            for (Long64_t event = first; event < last; event++) {
+                if (!pedestals.read(reader, event, channel_map)) {
+                    std::cerr << "Error reading event " << event << std::endl;
+                    return false;
+                }
+                extract_features(reader.adc(), reader.tot(), nullptr, channel_map, pedestals.snapshot(), features);
+                find_hits(features, hits);
+                totals.fill(features, hits);
+            }
+            return true;
+        },
+        [&]() {
+            std::vector<TObject*> objects;
+            for (auto hist : make_adc_tot_hists(totals.bank, channel_map)) {
+                if (hist) {
+                    objects.push_back(hist);
+                }
+            }
+            write_online_file(Form("output/Run%03d_adc_tot_online.root", run), objects);
+            for (auto object : objects) {
+                delete object;
+            }
+        });
+    if (status != FOLLOW_DONE) {
+        std::cerr << "Run " << run << " was not completed, no fits" << std::endl;
+        return false;
+    }
+    return fit_adc_tot(totals, channel_map, run_output_name(run), n_threads);
+}
+
+// Module of the fused driver, with the same outputs as adc_tot_correlation
+class AdcTotModule : public AnalysisModule {
+public:
+    AdcTotModule(int run, int n_threads)
+        : run(run), n_threads(n_threads), totals(eeemcal_channel_maps[READOUT_16I]) {}
+
+    const char *name() const override { return "adc_tot_correlation"; }
+    int branches() const override { return BRANCH_ADC | BRANCH_TOT; }
+
+    std::unique_ptr<ModuleState> make_state(int) const override {
+        return std::unique_ptr<ModuleState>(new State);
+    }
+    void merge(ModuleState &state) override {
+        totals.add(static_cast<State &>(state).histograms);
+    }
+    void finish() override {
+        fit_adc_tot(totals, eeemcal_channel_maps[READOUT_16I], run_output_name(run), n_threads);
+    }
+
+private:
+    struct State : public ModuleState {
+        AdcTotHistograms histograms{eeemcal_channel_maps[READOUT_16I]};
+
+        void process(Long64_t, EventReader &, const WaveformFeatures &features, const HitList &hits) override {
+            histograms.fill(features, hits);
+        }
+    };
+
+    int run;
+    int n_threads;
+    AdcTotHistograms totals;
+};
+
+std::unique_ptr<AnalysisModule> make_adc_tot_module(int run, int n_threads) {
+    return std::unique_ptr<AnalysisModule>(new AdcTotModule(run, n_threads));
+}
+
+bool merge_adc_tot_runs(const std::string &name, const std::vector<int> &runs, int n_threads) {
+    const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+    AdcTotHistograms totals(channel_map);
+    // The accumulators are read on the worker threads and added in run order
+    bool ok = ordered_reduce<AdcTotHistograms>(runs.size(), n_threads,
+        [&](int i, int thread) {
+            std::string path = accumulator_path(run_output_name(runs[i]).file, "adc_tot");
+            std::unique_ptr<TFile> file(TFile::Open(path.c_str()));
+            if (!file || file->IsZombie()) {
+                std::cerr << "Error opening " << path << std::endl;
+                return std::unique_ptr<AdcTotHistograms>();
+            }
+            std::unique_ptr<AdcTotHistograms> histograms(new AdcTotHistograms(channel_map));
+            if (!histograms->add_from(file.get())) {
+                return std::unique_ptr<AdcTotHistograms>();
+            }
+            return histograms;
+        },
+        [&](AdcTotHistograms &histograms) {
+            totals.add(histograms);
+        });
+    if (!ok) {
+        return false;
+    }
+    std::cout << "Merged " << runs.size() << " runs, " << totals.n_events << " events" << std::endl;
+    return fit_adc_tot(totals, channel_map, {name, name, -1}, n_threads);
+}
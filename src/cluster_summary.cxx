@@ -0,0 +1,140 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_cluster.h"
+#include "eeemcal_histogram_bank.h"
+#include "eeemcal_mapping.h"
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TParameter.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+// Events clustered together by find_clusters
+static const int CLUSTER_BATCH = 64;
+
+std::string cluster_summary_path(int run) {
+    return Form("output/Run%03d_clusters.root", run);
+}
+
+// Cluster of every event around its own seed crystal, so the spectra follow
+// the beam spot wherever it is: the seed crystal map, the 3x3 energy per
+// seed crystal, the 5x5 energy and the containment fractions.  The crystal
+// energies are the sums of the hit amplitudes, without gain corrections.
+class ClusterSummaryModule : public AnalysisModule {
+public:
+    ClusterSummaryModule(int run) : run(run) {}
+
+    const char *name() const override { return "cluster_summary"; }
+    int branches() const override { return BRANCH_ADC; }
+
+    std::unique_ptr<ModuleState> make_state(int) const override {
+        return std::unique_ptr<ModuleState>(new State);
+    }
+    void merge(ModuleState &state) override {
+        State &chunk = static_cast<State &>(state);
+        chunk.flush();
+        totals.add(chunk.histograms);
+    }
+    void finish() override {
+        std::string path = cluster_summary_path(run);
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error writing " << path << std::endl;
+            return;
+        }
+        std::unique_ptr<TH1D> seeds(totals.seeds.to_th1(0, "seed_crystal", "Seed Crystal;Pad;Events"));
+        seeds->Write();
+        for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+            int id = crystal_ID[crystal];
+            std::unique_ptr<TH1D> e_3x3(totals.e_3x3.to_th1(crystal, Form("e_3x3_seed_%d", id),
+                                                            Form("3x3 ADC Sum, Seed Crystal %d;ADC;Events", id)));
+            e_3x3->Write();
+        }
+        const char *names[4] = {"e_5x5", "e1_e9", "e9_e25", "e9_total"};
+        const char *titles[4] = {"5x5 ADC Sum;ADC;Events", "Seed / 3x3;E1/E9;Events",
+                                 "3x3 / 5x5;E9/E25;Events", "3x3 / All Crystals;E9/E_{total};Events"};
+        const HistogramBank1D *banks[4] = {&totals.e_5x5, &totals.e1_e9, &totals.e9_e25, &totals.e9_total};
+        for (int i = 0; i < 4; i++) {
+            std::unique_ptr<TH1D> hist(banks[i]->to_th1(0, names[i], titles[i]));
+            hist->Write();
+        }
+        TParameter<Long64_t>("n_events", totals.n_events).Write();
+        TParameter<Long64_t>("n_clusters", totals.n_clusters).Write();
+        file->Close();
+        std::cout << "Clustered " << totals.n_clusters << " of " << totals.n_events << " events in " << path << std::endl;
+    }
+
+private:
+    struct ClusterHistograms {
+        HistogramBank1D seeds{1, NUM_CRYSTALS, 0, NUM_CRYSTALS};
+        HistogramBank1D e_3x3{NUM_CRYSTALS, 256, 0, 16384};   // per seed crystal
+        HistogramBank1D e_5x5{1, 256, 0, 16384};
+        HistogramBank1D e1_e9{1, 110, 0, 1.1};
+        HistogramBank1D e9_e25{1, 110, 0, 1.1};
+        HistogramBank1D e9_total{1, 110, 0, 1.1};
+        Long64_t n_events = 0;
+        Long64_t n_clusters = 0;
+
+        void fill(const Cluster &cluster) {
+            n_events++;
+            if (cluster.seed < 0) {
+                return;
+            }
+            n_clusters++;
+            seeds.fill(0, cluster.seed);
+            e_3x3.fill(cluster.seed, cluster.e_3x3);
+            e_5x5.fill(0, cluster.e_5x5);
+            e1_e9.fill(0, cluster.e1_e9);
+            e9_e25.fill(0, cluster.e9_e25);
+            e9_total.fill(0, cluster.e9_total);
+        }
+        void add(const ClusterHistograms &other) {
+            seeds.add(other.seeds);
+            e_3x3.add(other.e_3x3);
+            e_5x5.add(other.e_5x5);
+            e1_e9.add(other.e1_e9);
+            e9_e25.add(other.e9_e25);
+            e9_total.add(other.e9_total);
+            n_events += other.n_events;
+            n_clusters += other.n_clusters;
+        }
+    };
+
+    // The crystal energies of up to CLUSTER_BATCH events wait here until
+    // the batch is full or the chunk is merged
+    struct State : public ModuleState {
+        ClusterHistograms histograms;
+        float energy[CLUSTER_BATCH][NUM_CRYSTALS];
+        Cluster clusters[CLUSTER_BATCH];
+        int n_batch = 0;
+
+        void process(Long64_t, EventReader &, const WaveformFeatures &, const HitList &hits) override {
+            const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+            float *event_energy = energy[n_batch];
+            std::fill(event_energy, event_energy + NUM_CRYSTALS, 0.0f);
+            for (const Hit &hit : hits) {
+                event_energy[channel_map.crystal_of(hit.index)] += hit.amplitude;
+            }
+            if (++n_batch == CLUSTER_BATCH) {
+                flush();
+            }
+        }
+        void flush() {
+            find_clusters(energy, n_batch, clusters);
+            for (int event = 0; event < n_batch; event++) {
+                histograms.fill(clusters[event]);
+            }
+            n_batch = 0;
+        }
+    };
+
+    int run;
+    ClusterHistograms totals;
+};
+
+std::unique_ptr<AnalysisModule> make_cluster_summary_module(int run) {
+    return std::unique_ptr<AnalysisModule>(new ClusterSummaryModule(run));
+}
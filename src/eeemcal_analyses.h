@@ -0,0 +1,113 @@
+#pragma once
+
+#include "eeemcal_driver.h"
+#include "eeemcal_follow.h"
+#include "eeemcal_render.h"
+#include "eeemcal_run_catalog.h"
+
+#include <TString.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Names of the outputs of one run, or of several merged runs
+struct OutputName {
+    std::string file;    // prefix of the output files, "Run056"
+    std::string title;   // in the plot titles, "Run 56"
+    int run;             // -1 for merged runs
+};
+
+inline OutputName run_output_name(int run) {
+    return {Form("Run%03d", run), Form("Run %d", run), run};
+}
+
+// Entry points of the compiled analyses.  They are called from the
+// standalone executables in apps/ and from the ROOT macro wrappers in the
+// top level directory.
+// n_threads = 0 uses one thread per core, for the event loop and the fits.
+// The result does not depend on the number of threads.  With use_cache the
+// per-event features are kept in output/RunNNN_features_16i/ and reused
+// while the run file is unchanged.  beam_energy (GeV, from the run log)
+// selects the fit start values of earlier runs, <= 0 for the defaults.
+// They return false if the run cannot be read or the results cannot be
+// written.  The macro wrappers of the same name as the top level files
+// turn that into the exit status of root -q.
+bool single_crystal_ADC_sum_offline(int run_number, int n_threads = 0, bool use_cache = true, double beam_energy = 0);
+bool adc_tot_correlation_offline(int run, int n_threads = 0);
+
+// Online versions that follow a run file while the decoder writes it (see
+// FollowOptions) and rewrite output/RunNNN_adc_sum_online.root and
+// output/RunNNN_adc_tot_online.root with the spectra so far.  Once the
+// decoder has marked the run complete they also make the fits, plots and
+// calibration outputs of the offline versions from the same histograms.
+// They return false, without fits, if the run was never marked complete.
+bool single_crystal_ADC_sum_follow(int run_number, const FollowOptions &options, int n_threads = 0, double beam_energy = 0);
+bool adc_tot_correlation_follow(int run, const FollowOptions &options, int n_threads = 0);
+
+// Event displays of the ADC or ToT waveforms (branch BRANCH_ADC or
+// BRANCH_TOT) of a list of events, in the SiPM layout of readout `mode`
+// (READOUT_16I, READOUT_4X4 or READOUT_16P).  The events are the pages of
+// output/RunNNN_event_display_{adc,tot}.pdf, or with images one
+// output/RunNNN_event_display_{adc,tot}_NNNNNN.png each.  Only those events
+// are read, and they are drawn by up to n_workers processes (0 for one per
+// core) that each reuse one canvas.
+struct EventDisplayOptions {
+    int branch = BRANCH_ADC;
+    int mode = 0;
+    std::vector<Long64_t> events;
+    bool images = false;
+};
+bool display_events(int run, EventDisplayOptions options, int n_workers = 0);
+// "0-9,15,100" -> 0, ..., 9, 15, 100; false if the list is malformed
+bool parse_event_list(const std::string &text, std::vector<Long64_t> &events);
+// The 10 events from `event`, as a PDF
+void event_display(int run, int event = 0, int mode = 0);
+void event_display_tot(int run, int event = 0, int mode = 0);
+
+// The analyses as modules of the fused driver, see run_analysis_modules.
+// Their outputs are those of the functions above.  The ADC sum module does
+// not read the feature cache, the driver extracts the features anyway, but
+// with use_cache it writes it when it is missing or stale.
+std::unique_ptr<AnalysisModule> make_adc_sum_module(int run_number, int n_threads = 0, bool use_cache = true, double beam_energy = 0);
+std::unique_ptr<AnalysisModule> make_adc_tot_module(int run, int n_threads = 0);
+std::unique_ptr<AnalysisModule> make_event_display_module(int run, const EventDisplayOptions &options);
+// Keys of every event of the run for the display and query tools, see
+// eeemcal_event_index.h
+std::unique_ptr<AnalysisModule> make_event_index_module(int run);
+// Center crystal ADC sum of a run for the position scan, written to
+// position_summary_path(run)
+std::unique_ptr<AnalysisModule> make_position_summary_module(int run);
+std::string position_summary_path(int run);
+// Per crystal TOA and ToT sample and ADC at TOA spectra, and per channel
+// counts of multiple TOA or ToT hits, written to timing_summary_path(run)
+std::unique_ptr<AnalysisModule> make_timing_summary_module(int run);
+std::string timing_summary_path(int run);
+// Cluster of every event around its seed crystal (see eeemcal_cluster.h):
+// seed map, 3x3 energy per seed, 5x5 energy and containment fractions,
+// written to cluster_summary_path(run)
+std::unique_ptr<AnalysisModule> make_cluster_summary_module(int run);
+std::string cluster_summary_path(int run);
+
+// Every analysis that finishes a run also writes its accumulators, the
+// filled histogram banks and event counters, to
+// output/RunNNN_<analysis>_accumulators.root.  The merge functions add the
+// accumulators of `runs`, on up to n_threads threads, and make the fits,
+// plots and outputs of the analysis from the sum as output/<name>_*, with an
+// accumulator file of their own that can be merged again.
+bool merge_adc_sum_runs(const std::string &name, const std::vector<int> &runs, int n_threads = 0);
+bool merge_adc_tot_runs(const std::string &name, const std::vector<int> &runs, int n_threads = 0);
+inline std::string accumulator_path(const std::string &output_file, const char *analysis) {
+    return Form("output/%s_%s_accumulators.root", output_file.c_str(), analysis);
+}
+
+// The fits write their results, the spectra with the fits attached and the
+// derived constants, to output/<name>_<analysis>_results.root, and the PDFs
+// are drawn from that file only: right after the fits unless --no-plots
+// (see RenderOptions), or later with render_plots.  The render jobs draw the
+// documents of a results file, e.g. "Run056" or a merged name.
+std::vector<RenderJob> adc_sum_render_jobs(const std::string &output_file);
+std::vector<RenderJob> adc_tot_render_jobs(const std::string &output_file);
+inline std::string results_path(const std::string &output_file, const char *analysis) {
+    return Form("output/%s_%s_results.root", output_file.c_str(), analysis);
+}
@@ -0,0 +1,68 @@
+#include "eeemcal_calibration.h"
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TParameter.h>
+#include <TSystem.h>
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+static std::unique_ptr<TFile> open_calibration_file(const char *path) {
+    if (!path || gSystem->AccessPathName(path)) {
+        return nullptr;
+    }
+    std::unique_ptr<TFile> file(TFile::Open(path));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening calibration file " << path << std::endl;
+        return nullptr;
+    }
+    return file;
+}
+
+// Copy the per channel contents of `name` into values, false if it is missing
+static bool read_channel_values(TFile &file, const char *name, float *values) {
+    TH1 *hist = nullptr;
+    file.GetObject(name, hist);
+    if (!hist) {
+        return false;
+    }
+    int first_bin = 0;
+    TParameter<int> *first_channel_bin = nullptr;
+    file.GetObject("first_channel_bin", first_channel_bin);
+    if (first_channel_bin) {
+        first_bin = first_channel_bin->GetVal();
+    }
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+        values[channel] = hist->GetBinContent(channel + first_bin);
+    }
+    return true;
+}
+
+void load_calibration(const char *gain_path, const char *tot_path, Calibration &calibration) {
+    calibration = Calibration();
+
+    auto gain_file = open_calibration_file(gain_path);
+    if (gain_file) {
+        calibration.has_gain = read_channel_values(*gain_file, "gain_factors", calibration.gain);
+    }
+
+    auto tot_file = open_calibration_file(tot_path);
+    if (tot_file) {
+        calibration.has_tot = read_channel_values(*tot_file, "adc_tot_slope", calibration.tot_slope)
+                           && read_channel_values(*tot_file, "adc_tot_intercept", calibration.tot_intercept);
+    }
+
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+        unsigned char flags = 0;
+        if (calibration.has_gain && std::isfinite(calibration.gain[channel]) && calibration.gain[channel] > 0) {
+            flags |= CALIB_GAIN;
+        }
+        if (calibration.has_tot && std::isfinite(calibration.tot_slope[channel]) && calibration.tot_slope[channel] != 0
+            && std::isfinite(calibration.tot_intercept[channel])) {
+            flags |= CALIB_TOT;
+        }
+        calibration.flags[channel] = flags;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "eeemcal_mapping.h"
+
+// Flags of the per channel calibration constants
+const int CALIB_GAIN = 1 << 0;
+const int CALIB_TOT = 1 << 1;
+
+// Bin of channel 0 in the calibration histograms written by the analyses.
+// They record it as a "first_channel_bin" TParameter; older files without
+// it stored channel c in bin c, so channel 0 ended up in the underflow bin.
+const int FIRST_CHANNEL_BIN = 1;
+
+// Gain and ToT conversion constants, loaded once into flat arrays indexed by
+// the readout channel (0 to NUM_CHANNELS - 1, ChannelMap::channel).  Channels
+// without a constant read as 0 and have their flag cleared; the analyses
+// check the flags per channel rather than has_gain/has_tot.
+struct Calibration {
+    bool has_gain = false;
+    bool has_tot = false;
+    alignas(64) float gain[NUM_CHANNELS] = {};
+    alignas(64) float tot_slope[NUM_CHANNELS] = {};
+    alignas(64) float tot_intercept[NUM_CHANNELS] = {};
+    alignas(64) unsigned char flags[NUM_CHANNELS] = {};   // CALIB_GAIN | CALIB_TOT
+
+    bool gain_valid(int channel) const { return flags[channel] & CALIB_GAIN; }
+    bool tot_valid(int channel) const { return flags[channel] & CALIB_TOT; }
+};
+
+// Load `gain_factors` from gain_path and `adc_tot_slope`/`adc_tot_intercept`
+// from tot_path.  A missing file or histogram leaves that part unset
+// (has_gain/has_tot false), like running without corrections.
+void load_calibration(const char *gain_path, const char *tot_path, Calibration &calibration);
@@ -0,0 +1,86 @@
+#include "eeemcal_cluster.h"
+
+#include <algorithm>
+#include <cmath>
+
+void find_clusters(const float (*crystal_energy)[NUM_CRYSTALS], int n, Cluster *clusters) {
+    for (int event = 0; event < n; event++) {
+        const float *energy = crystal_energy[event];
+        // The first crystal of a tie wins, like the leading crystal of the
+        // event index
+        int seed = 0;
+        float seed_energy = energy[0];
+        float total = 0;
+        for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+            bool higher = energy[crystal] > seed_energy;
+            seed = higher ? crystal : seed;
+            seed_energy = higher ? energy[crystal] : seed_energy;
+            total += energy[crystal];
+        }
+        const float *window_3x3 = neighbour_tables.window_3x3[seed];
+        const float *window_5x5 = neighbour_tables.window_5x5[seed];
+        float e_3x3 = 0;
+        float e_5x5 = 0;
+        #pragma omp simd reduction(+:e_3x3, e_5x5)
+        for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+            e_3x3 += window_3x3[crystal] * energy[crystal];
+            e_5x5 += window_5x5[crystal] * energy[crystal];
+        }
+        bool has_seed = seed_energy > 0;
+        Cluster &cluster = clusters[event];
+        cluster.seed = has_seed ? seed : -1;
+        cluster.seed_energy = seed_energy;
+        cluster.e_3x3 = e_3x3;
+        cluster.e_5x5 = e_5x5;
+        cluster.total = total;
+        cluster.e1_e9 = has_seed ? seed_energy / e_3x3 : 0;
+        cluster.e9_e25 = has_seed ? e_3x3 / e_5x5 : 0;
+        cluster.e9_total = has_seed ? e_3x3 / total : 0;
+    }
+}
+
+// Log weighted centroid of n points with energies e and coordinates x, y
+static void log_weighted_centroid(const float *energy, const float *x, const float *y, int n, float &x_mean, float &y_mean) {
+    float sum = 0;
+    #pragma omp simd reduction(+:sum)
+    for (int i = 0; i < n; i++) {
+        sum += energy[i];
+    }
+    x_mean = 0;
+    y_mean = 0;
+    if (!(sum > 0)) {
+        return;
+    }
+    float log_sum = std::log(sum);
+    float weight_sum = 0;
+    float x_sum = 0;
+    float y_sum = 0;
+    #pragma omp simd reduction(+:weight_sum, x_sum, y_sum)
+    for (int i = 0; i < n; i++) {
+        float weight = energy[i] > 0 ? std::max(0.0f, POSITION_LOG_WEIGHT + std::log(energy[i]) - log_sum) : 0.0f;
+        weight_sum += weight;
+        x_sum += weight * x[i];
+        y_sum += weight * y[i];
+    }
+    if (weight_sum > 0) {
+        x_mean = x_sum / weight_sum;
+        y_mean = y_sum / weight_sum;
+    }
+}
+
+EventPosition reconstruct_position(const float crystal_energy[NUM_CRYSTALS], int seed,
+                                   const float seed_sipm_energy[MAX_SIPMS_PER_CRYSTAL], int readout) {
+    EventPosition position = {0, 0, 0, 0};
+    if (seed < 0) {
+        return position;
+    }
+    log_weighted_centroid(crystal_energy, position_tables.crystal_x, position_tables.crystal_y, NUM_CRYSTALS,
+                          position.x, position.y);
+    float offset_x = 0;
+    float offset_y = 0;
+    log_weighted_centroid(seed_sipm_energy, position_tables.sipm_x[readout], position_tables.sipm_y[readout],
+                          sipms_per_crystal[readout], offset_x, offset_y);
+    position.x_sipm = position_tables.crystal_x[seed] + offset_x;
+    position.y_sipm = position_tables.crystal_y[seed] + offset_y;
+    return position;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "eeemcal_mapping.h"
+
+// Geometry of the 5x5 crystal array and the clustering built on it.  Like
+// eeemcal_mapping.h the tables are constexpr, built and checked at compile
+// time, so the ROOT macros can include this header without the library.
+//
+// Crystals are addressed by pad index row * 5 + column, row 0 at the top,
+// the order of crystal_ID.
+
+const int CRYSTAL_ROWS = 5;
+const int CRYSTAL_COLUMNS = 5;
+const int CENTER_CRYSTAL = 12;
+// Crystal pitch in mm, see crystal_positions.py
+constexpr double CRYSTAL_PITCH = 21.26;
+
+constexpr int crystal_row(int crystal) { return crystal / CRYSTAL_COLUMNS; }
+constexpr int crystal_column(int crystal) { return crystal % CRYSTAL_COLUMNS; }
+
+// Center of a crystal in mm, from the center of the array, y up
+constexpr float crystal_x(int crystal) { return (crystal_column(crystal) - 2) * CRYSTAL_PITCH; }
+constexpr float crystal_y(int crystal) { return (2 - crystal_row(crystal)) * CRYSTAL_PITCH; }
+
+// The SiPMs of a crystal sit on a square grid.  Slot s of the grid is row
+// s / side, column s % side, row 0 at the top, seen from the beam.
+constexpr int sipms_per_side(int readout) {
+    return sipms_per_crystal[readout] == 16 ? 4 : sipms_per_crystal[readout] == 4 ? 2 : 1;
+}
+
+// Grid slot of each SiPM index of a connector, the index of the channel
+// tables in eeemcal_mapping.h.  ASSUMED, not taken from a drawing: nothing
+// in the mapping records where on the crystal face a SiPM index sits, and
+// these tables are the identity, SiPM index i in slot i.  x_sipm and y_sipm
+// of the event index are only meaningful once they are checked against the
+// board layout; the crystal centroid does not depend on them.
+constexpr int sipm_grid_slot[NUM_READOUT_MODES][MAX_SIPMS_PER_CRYSTAL] = {
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},   // 16i
+    { 0,  1,  2,  3},                                                   // 4x4
+    { 0}};                                                              // 16p
+
+// Offset of a SiPM from the center of its crystal in mm
+constexpr float sipm_x(int readout, int sipm) {
+    return (sipm_grid_slot[readout][sipm] % sipms_per_side(readout) - (sipms_per_side(readout) - 1) / 2.0f)
+           * CRYSTAL_PITCH / sipms_per_side(readout);
+}
+constexpr float sipm_y(int readout, int sipm) {
+    return ((sipms_per_side(readout) - 1) / 2.0f - sipm_grid_slot[readout][sipm] / sipms_per_side(readout))
+           * CRYSTAL_PITCH / sipms_per_side(readout);
+}
+
+// Every slot of a grid is taken by exactly one SiPM
+constexpr bool is_sipm_grid(int readout) {
+    for (int slot = 0; slot < sipms_per_crystal[readout]; slot++) {
+        int n = 0;
+        for (int sipm = 0; sipm < sipms_per_crystal[readout]; sipm++) {
+            n += sipm_grid_slot[readout][sipm] == slot;
+        }
+        if (n != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ring of crystal b around crystal a: 0 for a itself, 1 for the 8 crystals
+// around it, 2 for the next 16
+constexpr int crystal_ring(int a, int b) {
+    int rows = crystal_row(a) > crystal_row(b) ? crystal_row(a) - crystal_row(b) : crystal_row(b) - crystal_row(a);
+    int columns = crystal_column(a) > crystal_column(b) ? crystal_column(a) - crystal_column(b) : crystal_column(b) - crystal_column(a);
+    return rows > columns ? rows : columns;
+}
+
+// For every seed crystal, the weight (1 or 0) of each crystal in the 3x3
+// and 5x5 windows around it, clipped at the edges of the array.  A window
+// sum is a dot product with a row, with no branch on the geometry.
+struct NeighbourTables {
+    float window_3x3[NUM_CRYSTALS][NUM_CRYSTALS] = {};
+    float window_5x5[NUM_CRYSTALS][NUM_CRYSTALS] = {};
+    int n_3x3[NUM_CRYSTALS] = {};    // crystals in the window, 4 to 9
+    int n_5x5[NUM_CRYSTALS] = {};    // 9 to 25
+};
+
+constexpr NeighbourTables make_neighbour_tables() {
+    NeighbourTables tables;
+    for (int seed = 0; seed < NUM_CRYSTALS; seed++) {
+        for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+            int ring = crystal_ring(seed, crystal);
+            tables.window_3x3[seed][crystal] = ring <= 1;
+            tables.window_5x5[seed][crystal] = ring <= 2;
+            tables.n_3x3[seed] += ring <= 1;
+            tables.n_5x5[seed] += ring <= 2;
+        }
+    }
+    return tables;
+}
+
+constexpr NeighbourTables neighbour_tables = make_neighbour_tables();
+
+// Positions as flat tables, for the centroid loops
+struct PositionTables {
+    float crystal_x[NUM_CRYSTALS] = {};
+    float crystal_y[NUM_CRYSTALS] = {};
+    float sipm_x[NUM_READOUT_MODES][MAX_SIPMS_PER_CRYSTAL] = {};
+    float sipm_y[NUM_READOUT_MODES][MAX_SIPMS_PER_CRYSTAL] = {};
+};
+
+constexpr PositionTables make_position_tables() {
+    PositionTables tables;
+    for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+        tables.crystal_x[crystal] = crystal_x(crystal);
+        tables.crystal_y[crystal] = crystal_y(crystal);
+    }
+    for (int readout = 0; readout < NUM_READOUT_MODES; readout++) {
+        for (int sipm = 0; sipm < sipms_per_crystal[readout]; sipm++) {
+            tables.sipm_x[readout][sipm] = sipm_x(readout, sipm);
+            tables.sipm_y[readout][sipm] = sipm_y(readout, sipm);
+        }
+    }
+    return tables;
+}
+
+constexpr PositionTables position_tables = make_position_tables();
+
+// The fixed "center 9" crystals of the earlier analyses
+constexpr bool is_center_crystal(int crystal) { return crystal_ring(CENTER_CRYSTAL, crystal) <= 1; }
+
+static_assert(crystal_row(CENTER_CRYSTAL) == 2 && crystal_column(CENTER_CRYSTAL) == 2, "center crystal not in the middle");
+static_assert(neighbour_tables.n_3x3[CENTER_CRYSTAL] == 9 && neighbour_tables.n_5x5[CENTER_CRYSTAL] == 25, "center windows");
+static_assert(neighbour_tables.n_3x3[0] == 4 && neighbour_tables.n_5x5[0] == 9, "corner windows");
+static_assert(neighbour_tables.n_3x3[1] == 6 && neighbour_tables.n_5x5[1] == 12, "edge windows");
+static_assert(is_center_crystal(6) && is_center_crystal(18) && !is_center_crystal(5) && !is_center_crystal(23), "center 9");
+static_assert(crystal_x(CENTER_CRYSTAL) == 0 && crystal_y(CENTER_CRYSTAL) == 0 && crystal_x(0) < 0 && crystal_y(0) > 0, "crystal positions");
+static_assert(sipms_per_side(READOUT_16I) * sipms_per_side(READOUT_16I) == sipms_per_crystal[READOUT_16I]
+              && sipms_per_side(READOUT_4X4) * sipms_per_side(READOUT_4X4) == sipms_per_crystal[READOUT_4X4]
+              && sipms_per_side(READOUT_16P) * sipms_per_side(READOUT_16P) == sipms_per_crystal[READOUT_16P], "SiPM grids");
+static_assert(is_sipm_grid(READOUT_16I) && is_sipm_grid(READOUT_4X4) && is_sipm_grid(READOUT_16P), "SiPM grid slots");
+
+// Shower of one event around the crystal with the largest energy
+struct Cluster {
+    int seed;           // pad index, -1 if no crystal has energy
+    float seed_energy;
+    float e_3x3;        // the 3x3 window around the seed
+    float e_5x5;
+    float total;        // all crystals
+    float e1_e9;        // containment fractions, 0 without a seed
+    float e9_e25;
+    float e9_total;
+};
+
+// Clusters of n events from their crystal energies.  The events are done
+// together, with the seed found by a select instead of a branch and the
+// window sums as dot products with the table rows, so the loops over a
+// batch vectorize.
+void find_clusters(const float (*crystal_energy)[NUM_CRYSTALS], int n, Cluster *clusters);
+
+// Log weighted centroids, w = max(0, POSITION_LOG_WEIGHT + ln(E / E_sum)):
+// unlike linear weights they follow the exponential fall off of the shower
+// away from its axis.  Crystals below e^-POSITION_LOG_WEIGHT of the sum do
+// not count.
+const float POSITION_LOG_WEIGHT = 4;
+
+// Position of one event in mm
+struct EventPosition {
+    float x;            // over the crystals
+    float y;
+    float x_sipm;       // over the SiPMs of the seed crystal, see sipm_grid_slot
+    float y_sipm;
+};
+
+// From the crystal energies of an event, its seed crystal and the energies
+// of the SiPMs of that crystal in readout `readout`.  All zero if no crystal
+// has energy.
+EventPosition reconstruct_position(const float crystal_energy[NUM_CRYSTALS], int seed,
+                                   const float seed_sipm_energy[MAX_SIPMS_PER_CRYSTAL], int readout);
@@ -0,0 +1,169 @@
+#include "eeemcal_crystal_ball.h"
+
+#include <Math/Factory.h>
+#include <Math/Minimizer.h>
+#include <TAxis.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+static const char *parameter_names[CRYSTAL_BALL_NPAR] = {"alpha", "n", "x_bar", "sigma", "N", "offset"};
+
+CrystalBallModel::CrystalBallModel(const TH1 *hist, double lower_range, double upper_range) {
+    const TAxis *axis = hist->GetXaxis();
+    int first_bin = std::max(1, axis->FindFixBin(lower_range));
+    int last_bin = std::min(axis->GetNbins(), axis->FindFixBin(upper_range));
+    for (int bin = first_bin; bin <= last_bin; bin++) {
+        double center = axis->GetBinCenter(bin);
+        double error = hist->GetBinError(bin);
+        if (center < lower_range || center > upper_range || error <= 0) {
+            continue;
+        }
+        x.push_back(center);
+        y.push_back(hist->GetBinContent(bin));
+        weight.push_back(1 / (error * error));
+    }
+}
+
+// For t = (x - x_bar) / sigma the crystal ball is N * g(t) + offset with
+//   g = exp(-t^2 / 2)           for t > -alpha
+//   g = A * (B - t)^-n          otherwise
+//   A = (n / |alpha|)^n * exp(-alpha^2 / 2),  B = n / |alpha| - |alpha|
+// Both branches are evaluated as exp(log g) so each bin costs one exp and
+// one log, and the derivatives follow from those of log g.
+void CrystalBallModel::evaluate(const double *par) const {
+    if (evaluated && std::memcmp(par, last_par, sizeof(last_par)) == 0) {
+        return;
+    }
+
+    double alpha = par[0];
+    double n = par[1];
+    double x_bar = par[2];
+    double sigma = par[3];
+    double N = par[4];
+    double offset = par[5];
+
+    // Per parameter set constants
+    double abs_alpha = std::fabs(alpha);
+    double sign_alpha = alpha < 0 ? -1 : 1;
+    double log_A = n * std::log(n / abs_alpha) - 0.5 * alpha * alpha;
+    double B = n / abs_alpha - abs_alpha;
+    double dlog_A_dn = std::log(n / abs_alpha) + 1;
+    double dlog_A_dalpha = -sign_alpha * n / abs_alpha - alpha;
+    double dB_dn = 1 / abs_alpha;
+    double dB_dalpha = -sign_alpha * (n / (abs_alpha * abs_alpha) + 1);
+    double inverse_sigma = 1 / sigma;
+
+    double chi2 = 0;
+    double d_alpha = 0, d_n = 0, d_x_bar = 0, d_sigma = 0, d_N = 0, d_offset = 0;
+    int size = x.size();
+    const double *bin_x = x.data();
+    const double *bin_y = y.data();
+    const double *bin_weight = weight.data();
+    #pragma omp simd reduction(+:chi2, d_alpha, d_n, d_x_bar, d_sigma, d_N, d_offset)
+    for (int i = 0; i < size; i++) {
+        double t = (bin_x[i] - x_bar) * inverse_sigma;
+        bool tail = t <= -alpha;
+        // u > 0 in the tail; the clamp only keeps the unused lanes finite
+        double u = std::max(B - t, 1e-300);
+        double log_u = std::log(u);
+        double n_over_u = n / u;
+        double log_g = tail ? log_A - n * log_u : -0.5 * t * t;
+        double g = std::exp(log_g);
+        // d log g / d parameter
+        double dlog_g_dalpha = tail ? dlog_A_dalpha - n_over_u * dB_dalpha : 0;
+        double dlog_g_dn = tail ? dlog_A_dn - log_u - n_over_u * dB_dn : 0;
+        double dlog_g_dt = tail ? n_over_u : -t;
+        double dlog_g_dx_bar = -dlog_g_dt * inverse_sigma;
+        double dlog_g_dsigma = -dlog_g_dt * t * inverse_sigma;
+
+        double residual = bin_y[i] - (N * g + offset);
+        double w = bin_weight[i];
+        chi2 += w * residual * residual;
+        // d chi2 / d p = -2 w r df/dp, with df/dp = N g dlog g/dp for the
+        // shape parameters
+        double scale = -2 * w * residual;
+        double shape = scale * N * g;
+        d_alpha += shape * dlog_g_dalpha;
+        d_n += shape * dlog_g_dn;
+        d_x_bar += shape * dlog_g_dx_bar;
+        d_sigma += shape * dlog_g_dsigma;
+        d_N += scale * g;
+        d_offset += scale;
+    }
+
+    std::memcpy(last_par, par, sizeof(last_par));
+    last_chi2 = chi2;
+    last_gradient[0] = d_alpha;
+    last_gradient[1] = d_n;
+    last_gradient[2] = d_x_bar;
+    last_gradient[3] = d_sigma;
+    last_gradient[4] = d_N;
+    last_gradient[5] = d_offset;
+    evaluated = true;
+}
+
+double CrystalBallModel::DoEval(const double *par) const {
+    evaluate(par);
+    return last_chi2;
+}
+
+double CrystalBallModel::DoDerivative(const double *par, unsigned int coordinate) const {
+    evaluate(par);
+    return last_gradient[coordinate];
+}
+
+void CrystalBallModel::Gradient(const double *par, double *gradient) const {
+    evaluate(par);
+    std::copy(last_gradient, last_gradient + CRYSTAL_BALL_NPAR, gradient);
+}
+
+void CrystalBallModel::FdF(const double *par, double &value, double *gradient) const {
+    evaluate(par);
+    value = last_chi2;
+    std::copy(last_gradient, last_gradient + CRYSTAL_BALL_NPAR, gradient);
+}
+
+int fit_crystal_ball(TH1 *hist, TF1 *function) {
+    double lower_range, upper_range;
+    function->GetRange(lower_range, upper_range);
+    CrystalBallModel model(hist, lower_range, upper_range);
+
+    std::unique_ptr<ROOT::Math::Minimizer> minimizer(ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad"));
+    if (!minimizer) {
+        return -1;
+    }
+    minimizer->SetPrintLevel(0);
+    minimizer->SetErrorDef(1);
+    minimizer->SetFunction(model);
+    for (int par = 0; par < CRYSTAL_BALL_NPAR; par++) {
+        double value = function->GetParameter(par);
+        double lower, upper;
+        function->GetParLimits(par, lower, upper);
+        double step = value != 0 ? 0.1 * std::fabs(value) : 0.1;
+        if (lower < upper) {
+            minimizer->SetLimitedVariable(par, parameter_names[par], value, std::min(step, 0.1 * (upper - lower)), lower, upper);
+        } else if (lower * upper != 0 && lower >= upper) {
+            // FixParameter sets equal limits
+            minimizer->SetFixedVariable(par, parameter_names[par], value);
+        } else {
+            minimizer->SetVariable(par, parameter_names[par], value, step);
+        }
+    }
+    // Like TH1::Fit, a range with no more points than free parameters is
+    // not fit: the chi-square would be flat and Minuit2 would call it
+    // converged.  The function keeps its start values.
+    if (model.n_bins() <= int(minimizer->NFree())) {
+        return -1;
+    }
+    minimizer->Minimize();
+
+    function->SetParameters(minimizer->X());
+    function->SetParErrors(minimizer->Errors());
+    function->SetChisquare(minimizer->MinValue());
+    function->SetNDF(model.n_bins() - minimizer->NFree());
+    function->SetNumberFitPoints(model.n_bins());
+    return minimizer->Status();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Math/IFunction.h>
+#include <TF1.h>
+#include <TH1.h>
+
+#include <vector>
+
+const int CRYSTAL_BALL_NPAR = 6;
+
+// Chi-square of the crystal_ball function (eeemcal_fit.h) against the bins
+// of a histogram, with its analytic gradient.  It is what TH1::Fit minimizes
+// for the default chi-square fit, but:
+//  - the bins in range are copied once into flat arrays,
+//  - A, B and the other parameter dependent constants are computed once per
+//    parameter set instead of once per bin,
+//  - all bins are evaluated in one branch free loop, with the chi-square and
+//    its gradient as SIMD reductions,
+//  - the value and gradient of the last parameter set are memoized, since
+//    Minuit asks for both at the same point.
+class CrystalBallModel : public ROOT::Math::IMultiGradFunction {
+public:
+    // Bins of `hist` with their center in [lower_range, upper_range] and a
+    // non-zero error, like a TH1::Fit with the "R" option
+    CrystalBallModel(const TH1 *hist, double lower_range, double upper_range);
+
+    ROOT::Math::IMultiGradFunction *Clone() const override { return new CrystalBallModel(*this); }
+    unsigned int NDim() const override { return CRYSTAL_BALL_NPAR; }
+    void Gradient(const double *par, double *gradient) const override;
+    void FdF(const double *par, double &value, double *gradient) const override;
+
+    int n_bins() const { return x.size(); }
+
+private:
+    double DoEval(const double *par) const override;
+    double DoDerivative(const double *par, unsigned int coordinate) const override;
+    void evaluate(const double *par) const;
+
+    std::vector<double> x;        // bin centers
+    std::vector<double> y;        // bin contents
+    std::vector<double> weight;   // 1 / error^2
+
+    mutable bool evaluated = false;
+    mutable double last_par[CRYSTAL_BALL_NPAR];
+    mutable double last_chi2;
+    mutable double last_gradient[CRYSTAL_BALL_NPAR];
+};
+
+// Fit `function`, a create_fit_function crystal ball, to `hist` over the
+// function's range with Minuit2 and the analytic gradient.  The start
+// values, limits and fixed parameters are taken from the function, and the
+// fitted parameters, errors, chi-square and NDF are written back to it, as
+// TH1::Fit(function, "RQN") would.  Returns the minimizer status, 0 on success,
+// or -1 without a fit if the range has no more points than free parameters.
+int fit_crystal_ball(TH1 *hist, TF1 *function);
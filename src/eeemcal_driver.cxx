@@ -0,0 +1,86 @@
+#include "eeemcal_driver.h"
+#include "eeemcal_event_loop.h"
+#include "eeemcal_mapping.h"
+
+#include <TFile.h>
+#include <TString.h>
+#include <TTree.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Entries per chunk of the threaded event loop, rounded up to whole clusters.
+// The same as in single_crystal_ADC_sum, so the feature cache the adc_sum
+// module writes has the chunk layout that analysis expects.
+static const Long64_t CHUNK_ENTRIES = 20000;
+
+using ModuleStates = std::vector<std::unique_ptr<ModuleState>>;
+
+bool run_analysis_modules(int run_number, const std::vector<AnalysisModule*> &modules, int n_threads) {
+    auto path = getenv("OUTPUT_PATH");
+    std::string file_name = Form("%s/Run%03d.root", path, run_number);
+    std::unique_ptr<TFile> file(TFile::Open(file_name.c_str()));
+    TTree *tree = nullptr;
+    if (file && !file->IsZombie()) {
+        file->GetObject("events", tree);
+    }
+    if (!tree) {
+        std::cerr << "Error getting tree from " << file_name << std::endl;
+        return false;
+    }
+
+    // The features always need the ADC, the other branches are only read if
+    // a module asks for them
+    int branches = BRANCH_ADC;
+    for (auto module : modules) {
+        branches |= module->branches();
+        std::cout << "Running " << module->name() << " on Run " << run_number << std::endl;
+    }
+
+    const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+    std::vector<EntryRange> chunks = make_entry_chunks(tree, CHUNK_ENTRIES);
+    std::string source_uuid = file->GetUUID().AsString();
+    for (auto module : modules) {
+        module->begin(source_uuid, chunks);
+    }
+    bool ok = process_chunks<ModuleStates>(file_name, branches, chunks, n_threads,
+        [&](EventReader &reader, int chunk) {
+            std::unique_ptr<ModuleStates> states(new ModuleStates);
+            for (auto module : modules) {
+                states->push_back(module->make_state(chunk));
+            }
+            WaveformFeatures features;
+            PedestalTracker pedestals;
+            HitList hits;
+            for (Long64_t entry = chunks[chunk].first; entry < chunks[chunk].last; entry++) {
+                if (!pedestals.read(reader, entry, channel_map)) {
+                    std::cerr << "Error reading event " << entry << std::endl;
+                    return std::unique_ptr<ModuleStates>();
+                }
+                extract_features(reader.adc(), reader.tot(), reader.toa(), channel_map, pedestals.snapshot(), features);
+                find_hits(features, hits);
+                for (auto &state : *states) {
+                    state->process(entry, reader, features, hits);
+                }
+            }
+            for (auto &state : *states) {
+                state->end_chunk();
+            }
+            return states;
+        },
+        [&](ModuleStates &states) {
+            for (size_t i = 0; i < modules.size(); i++) {
+                modules[i]->merge(*states[i]);
+            }
+        });
+    if (!ok) {
+        std::cerr << "Error reading events" << std::endl;
+        return false;
+    }
+
+    for (auto module : modules) {
+        module->finish();
+    }
+    return true;
+}
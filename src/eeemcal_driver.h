@@ -0,0 +1,54 @@
+#pragma once
+
+#include "eeemcal_event_loop.h"
+#include "eeemcal_features.h"
+#include "eeemcal_hits.h"
+#include "eeemcal_reader.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fused event loop: the run file is read once, the features of every event
+// are extracted once, and both are handed to all registered analysis
+// modules, so a run pays I/O and decompression once however many analyses
+// look at it.
+//
+// Each chunk of the run fills a fresh ModuleState of every module on the
+// thread that reads it, and the states are merged into their modules in
+// chunk order (see ordered_reduce), so the results do not depend on the
+// number of threads.
+
+// Partial result of a module over one chunk
+class ModuleState {
+public:
+    virtual ~ModuleState() {}
+    // Called for every entry of the chunk, in order.  The features are those
+    // of the 16i channel map and the hits their zero suppressed view; the
+    // raw branches the module asked for are available from the reader.
+    virtual void process(Long64_t entry, EventReader &reader, const WaveformFeatures &features, const HitList &hits) = 0;
+    // Called after the last entry of the chunk, on the same thread
+    virtual void end_chunk() {}
+};
+
+class AnalysisModule {
+public:
+    virtual ~AnalysisModule() {}
+    virtual const char *name() const = 0;
+    // BRANCH_* flags of the raw branches the module reads
+    virtual int branches() const = 0;
+    // Called once before the event loop with the UUID of the run file and
+    // the chunks it is read in
+    virtual void begin(const std::string &source_uuid, const std::vector<EntryRange> &chunks) {}
+    // Called from the worker threads, for the state of chunk `chunk`
+    virtual std::unique_ptr<ModuleState> make_state(int chunk) const = 0;
+    // Called in chunk order with a state made by make_state
+    virtual void merge(ModuleState &state) = 0;
+    // Fits, plots and output files once every event has been merged
+    virtual void finish() = 0;
+};
+
+// Read run `run_number` from $OUTPUT_PATH once for all modules and finish
+// them.  Returns false, without finishing any module, if the run could not
+// be read.
+bool run_analysis_modules(int run_number, const std::vector<AnalysisModule*> &modules, int n_threads);
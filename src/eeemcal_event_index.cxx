@@ -0,0 +1,223 @@
+#include "eeemcal_event_index.h"
+#include "eeemcal_cluster.h"
+
+#include <TFile.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+const char *const EVENT_QUERY_USAGE =
+    "  --crystal ID  events whose leading crystal is crystal ID, as labelled on the prototype\n"
+    "  --min-total ADC, --min-center ADC  minimum ADC sum of all or of the center 9 crystals\n"
+    "  --min-tot N  at least N channels with a ToT\n"
+    "  --multi-toa  a channel with a TOA in more than one sample\n"
+    "  --multi-crystal  more than one crystal hit\n"
+    "  --top N  only the N largest by --order total|center|leading|tot (default total)\n";
+
+EventKey make_event_key(Long64_t entry, const WaveformFeatures &features, const HitList &hits,
+                        const ChannelMap &channel_map) {
+    EventKey key = {entry, 0, 0, 0, NO_LEADING_CRYSTAL, 0, 0, 0, 0, 0, 0};
+    float crystal_sums[NUM_CRYSTALS] = {};
+    for (const Hit &hit : hits) {
+        crystal_sums[channel_map.crystal_of(hit.index)] += hit.amplitude;
+        key.n_tot_active += hit.tot > 0;
+    }
+    for (int i = 0; i < features.n_channels; i++) {
+        if (features.n_toa[i] > 1) {
+            key.flags |= EVENT_MULTI_TOA;
+            break;
+        }
+    }
+    int n_hit_crystals = 0;
+    for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+        float crystal_sum = crystal_sums[crystal];
+        key.total_sum += crystal_sum;
+        if (is_center_crystal(crystal)) {
+            key.center_sum += crystal_sum;
+        }
+        if (crystal_sum > key.leading_sum) {
+            key.leading_sum = crystal_sum;
+            key.leading_crystal = crystal;
+        }
+        n_hit_crystals += crystal_sum > CRYSTAL_HIT_ADC;
+    }
+    if (n_hit_crystals > 1) {
+        key.flags |= EVENT_MULTI_CRYSTAL;
+    }
+    float sipm_sums[MAX_SIPMS_PER_CRYSTAL] = {};
+    for (const Hit &hit : hits) {
+        if (channel_map.crystal_of(hit.index) == key.leading_crystal) {
+            sipm_sums[channel_map.sipm_of(hit.index)] += hit.amplitude;
+        }
+    }
+    EventPosition position = reconstruct_position(crystal_sums, key.leading_crystal, sipm_sums, channel_map.readout);
+    key.x = position.x;
+    key.y = position.y;
+    key.x_sipm = position.x_sipm;
+    key.y_sipm = position.y_sipm;
+    return key;
+}
+
+std::string event_index_path(int run) {
+    return Form("output/Run%03d_event_index.root", run);
+}
+
+bool write_event_index(int run, const std::vector<EventKey> &keys) {
+    std::string path = event_index_path(run);
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+    EventKey key;
+    UChar_t leading_crystal;
+    UShort_t n_tot_active;
+    UChar_t flags;
+    TTree *tree = new TTree("event_index", "Event keys");
+    tree->SetDirectory(file.get());
+    tree->Branch("entry", &key.entry, "entry/L");
+    tree->Branch("total_sum", &key.total_sum, "total_sum/F");
+    tree->Branch("center_sum", &key.center_sum, "center_sum/F");
+    tree->Branch("leading_sum", &key.leading_sum, "leading_sum/F");
+    tree->Branch("leading_crystal", &leading_crystal, "leading_crystal/b");
+    tree->Branch("n_tot_active", &n_tot_active, "n_tot_active/s");
+    tree->Branch("flags", &flags, "flags/b");
+    tree->Branch("x", &key.x, "x/F");
+    tree->Branch("y", &key.y, "y/F");
+    tree->Branch("x_sipm", &key.x_sipm, "x_sipm/F");
+    tree->Branch("y_sipm", &key.y_sipm, "y_sipm/F");
+    for (const EventKey &event_key : keys) {
+        key = event_key;
+        leading_crystal = event_key.leading_crystal < 0 ? NO_LEADING_CRYSTAL_STORED : event_key.leading_crystal;
+        n_tot_active = event_key.n_tot_active;
+        flags = event_key.flags;
+        tree->Fill();
+    }
+    tree->Write();
+    file->Close();
+    return true;
+}
+
+bool read_event_index(int run, std::vector<EventKey> &keys) {
+    std::string path = event_index_path(run);
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str()));
+    TTree *tree = nullptr;
+    if (file && !file->IsZombie()) {
+        file->GetObject("event_index", tree);
+    }
+    if (!tree) {
+        std::cerr << "Error reading " << path << ", run analyze_run with the index module first" << std::endl;
+        return false;
+    }
+    EventKey key;
+    UChar_t leading_crystal;
+    UShort_t n_tot_active;
+    UChar_t flags;
+    tree->SetBranchAddress("entry", &key.entry);
+    tree->SetBranchAddress("total_sum", &key.total_sum);
+    tree->SetBranchAddress("center_sum", &key.center_sum);
+    tree->SetBranchAddress("leading_sum", &key.leading_sum);
+    tree->SetBranchAddress("leading_crystal", &leading_crystal);
+    tree->SetBranchAddress("n_tot_active", &n_tot_active);
+    tree->SetBranchAddress("flags", &flags);
+    tree->SetBranchAddress("x", &key.x);
+    tree->SetBranchAddress("y", &key.y);
+    tree->SetBranchAddress("x_sipm", &key.x_sipm);
+    tree->SetBranchAddress("y_sipm", &key.y_sipm);
+    Long64_t n_entries = tree->GetEntries();
+    keys.clear();
+    keys.reserve(n_entries);
+    for (Long64_t i = 0; i < n_entries; i++) {
+        tree->GetEntry(i);
+        key.leading_crystal = leading_crystal == NO_LEADING_CRYSTAL_STORED ? NO_LEADING_CRYSTAL : leading_crystal;
+        key.n_tot_active = n_tot_active;
+        key.flags = flags;
+        keys.push_back(key);
+    }
+    return true;
+}
+
+static float order_value(const EventKey &key, EventOrder order) {
+    switch (order) {
+    case ORDER_TOTAL_SUM: return key.total_sum;
+    case ORDER_CENTER_SUM: return key.center_sum;
+    case ORDER_LEADING_SUM: return key.leading_sum;
+    case ORDER_TOT_ACTIVE: return key.n_tot_active;
+    default: return -key.entry;
+    }
+}
+
+std::vector<EventKey> query_event_index(const std::vector<EventKey> &keys, const EventQuery &query) {
+    std::vector<EventKey> selected;
+    for (const EventKey &key : keys) {
+        if ((query.leading_crystal < 0 || key.leading_crystal == query.leading_crystal)
+            && key.total_sum >= query.min_total_sum && key.center_sum >= query.min_center_sum
+            && key.n_tot_active >= query.min_tot_active && (key.flags & query.flags) == query.flags) {
+            selected.push_back(key);
+        }
+    }
+    // Largest first, ties in entry order
+    auto larger = [&](const EventKey &a, const EventKey &b) {
+        float value_a = order_value(a, query.order);
+        float value_b = order_value(b, query.order);
+        return value_a != value_b ? value_a > value_b : a.entry < b.entry;
+    };
+    size_t limit = query.limit > 0 ? std::min<size_t>(query.limit, selected.size()) : selected.size();
+    if (query.order != ORDER_ENTRY) {
+        std::partial_sort(selected.begin(), selected.begin() + limit, selected.end(), larger);
+    }
+    selected.resize(limit);
+    return selected;
+}
+
+bool parse_event_query_option(int argc, char **argv, int &i, EventQuery &query, bool &used) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--crystal") == 0 && has_value) {
+        int label = std::atoi(argv[++i]);
+        const int *found = std::find(crystal_ID, crystal_ID + NUM_CRYSTALS, label);
+        // an unknown crystal selects no events
+        if (found == crystal_ID + NUM_CRYSTALS) {
+            std::cerr << "No crystal " << label << ", the crystals are 1-25" << std::endl;
+        }
+        query.leading_crystal = found - crystal_ID;
+    } else if (strcmp(argv[i], "--min-total") == 0 && has_value) {
+        query.min_total_sum = std::atof(argv[++i]);
+    } else if (strcmp(argv[i], "--min-center") == 0 && has_value) {
+        query.min_center_sum = std::atof(argv[++i]);
+    } else if (strcmp(argv[i], "--min-tot") == 0 && has_value) {
+        query.min_tot_active = std::atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--multi-toa") == 0) {
+        query.flags |= EVENT_MULTI_TOA;
+    } else if (strcmp(argv[i], "--multi-crystal") == 0) {
+        query.flags |= EVENT_MULTI_CRYSTAL;
+    } else if (strcmp(argv[i], "--top") == 0 && has_value) {
+        query.limit = std::atoi(argv[++i]);
+        if (query.order == ORDER_ENTRY) {
+            query.order = ORDER_TOTAL_SUM;
+        }
+    } else if (strcmp(argv[i], "--order") == 0 && has_value) {
+        const char *order = argv[++i];
+        if (strcmp(order, "total") == 0) {
+            query.order = ORDER_TOTAL_SUM;
+        } else if (strcmp(order, "center") == 0) {
+            query.order = ORDER_CENTER_SUM;
+        } else if (strcmp(order, "leading") == 0) {
+            query.order = ORDER_LEADING_SUM;
+        } else if (strcmp(order, "tot") == 0) {
+            query.order = ORDER_TOT_ACTIVE;
+        } else if (strcmp(order, "entry") == 0) {
+            query.order = ORDER_ENTRY;
+        } else {
+            std::cerr << "Unknown order " << order << ", the orders are total, center, leading, tot and entry" << std::endl;
+            query.valid = false;
+        }
+    } else {
+        return false;
+    }
+    used = true;
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "eeemcal_hits.h"
+#include "eeemcal_mapping.h"
+
+#include <TTree.h>
+
+#include <string>
+#include <vector>
+
+// Per-run index of compact event keys, output/RunNNN_event_index.root,
+// written by the index module of the fused driver during the main pass.
+// The display and query tools select events on the keys and then read only
+// those entries of the run file.
+//
+// The sums are of the pedestal subtracted max ADC of the hits of the 16i
+// channels, without gain corrections.  The positions are the log weighted
+// centroids of reconstruct_position, in mm from the center crystal.  The
+// SiPM centroid relies on an assumed SiPM layout, see sipm_grid_slot.
+
+// Flags of an event
+const int EVENT_MULTI_TOA = 1 << 0;       // a channel with a TOA in more than one sample
+const int EVENT_MULTI_CRYSTAL = 1 << 1;   // more than one crystal above CRYSTAL_HIT_ADC
+
+// ADC sum above which a crystal counts as hit for EVENT_MULTI_CRYSTAL
+const float CRYSTAL_HIT_ADC = 1000;
+
+// Leading crystal of an event without any hit amplitude, like the seed of
+// an empty Cluster, and how it is stored in the unsigned byte of the file
+const int NO_LEADING_CRYSTAL = -1;
+const int NO_LEADING_CRYSTAL_STORED = 255;
+
+struct EventKey {
+    Long64_t entry;
+    float total_sum;        // all crystals
+    float center_sum;       // the center 9 crystals
+    float leading_sum;      // the crystal with the largest sum
+    int leading_crystal;    // pad index 0-24, see crystal_ID for the label,
+                            // NO_LEADING_CRYSTAL without any hit amplitude
+    int n_tot_active;       // channels with a ToT
+    int flags;
+    float x;                // over the crystals
+    float y;
+    float x_sipm;           // over the SiPMs of the leading crystal, with the
+                            // assumed SiPM layout of sipm_grid_slot
+    float y_sipm;
+};
+
+// The sums and positions from the hits, the multi TOA flag from the
+// features of every channel, as a TOA is not a hit by itself
+EventKey make_event_key(Long64_t entry, const WaveformFeatures &features, const HitList &hits,
+                        const ChannelMap &channel_map);
+
+std::string event_index_path(int run);
+bool write_event_index(int run, const std::vector<EventKey> &keys);
+bool read_event_index(int run, std::vector<EventKey> &keys);
+
+enum EventOrder { ORDER_ENTRY, ORDER_TOTAL_SUM, ORDER_CENTER_SUM, ORDER_LEADING_SUM, ORDER_TOT_ACTIVE };
+
+// Events passing every cut, the largest `limit` of them by `order` (all of
+// them for limit 0), or in entry order for ORDER_ENTRY
+struct EventQuery {
+    int leading_crystal = -1;   // pad index, -1 for any
+    float min_total_sum = 0;
+    float min_center_sum = 0;
+    int min_tot_active = 0;
+    int flags = 0;              // flags the events must all have
+    EventOrder order = ORDER_ENTRY;
+    int limit = 0;
+    bool valid = true;          // false after an option with a bad value
+};
+
+std::vector<EventKey> query_event_index(const std::vector<EventKey> &keys, const EventQuery &query);
+
+// Command line options of the tools for a query: --crystal ID (the label
+// on the prototype), --min-total ADC, --min-center ADC, --min-tot N,
+// --multi-toa, --multi-crystal, --top N and --order
+// total|center|leading|tot|entry.  Returns true if argv[i] is one of them,
+// advancing i past its value; `used` is set once any of them is given.
+// A bad value is reported and clears query.valid.
+bool parse_event_query_option(int argc, char **argv, int &i, EventQuery &query, bool &used);
+extern const char *const EVENT_QUERY_USAGE;
@@ -0,0 +1,69 @@
+#include "eeemcal_event_loop.h"
+
+#include <iostream>
+
+std::vector<EntryRange> make_entry_chunks(TTree *tree, Long64_t min_entries) {
+    std::vector<EntryRange> chunks;
+    Long64_t n_entries = tree->GetEntries();
+    Long64_t chunk_first = 0;
+    auto clusters = tree->GetClusterIterator(0);
+    while (clusters.Next() < n_entries) {
+        Long64_t cluster_end = std::min(clusters.GetNextEntry(), n_entries);
+        if (cluster_end - chunk_first >= min_entries) {
+            chunks.push_back({chunk_first, cluster_end});
+            chunk_first = cluster_end;
+        }
+    }
+    if (chunk_first < n_entries) {
+        chunks.push_back({chunk_first, n_entries});
+    }
+    return chunks;
+}
+
+int resolve_thread_count(int n_threads) {
+    if (n_threads > 0) {
+        return n_threads;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(int n_tasks, int n_threads, const std::function<void(int, int)> &task) {
+    n_threads = std::min(resolve_thread_count(n_threads), std::max(n_tasks, 1));
+    std::atomic<int> next_task(0);
+    auto worker = [&](int thread) {
+        for (int i = next_task++; i < n_tasks; i = next_task++) {
+            task(i, thread);
+        }
+    };
+    if (n_threads == 1) {
+        worker(0);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < n_threads; thread++) {
+        threads.emplace_back(worker, thread);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+std::vector<ThreadReader> open_thread_readers(const std::string &file_name, int branches, int n_threads) {
+    std::vector<ThreadReader> readers(n_threads);
+    for (auto &thread_reader : readers) {
+        thread_reader.file.reset(TFile::Open(file_name.c_str()));
+        TTree *tree = nullptr;
+        if (thread_reader.file && !thread_reader.file->IsZombie()) {
+            thread_reader.file->GetObject("events", tree);
+        }
+        if (!tree) {
+            std::cerr << "Error getting tree from " << file_name << std::endl;
+            return {};
+        }
+        thread_reader.reader.reset(new EventReader(tree, branches));
+        if (!thread_reader.reader->is_valid()) {
+            return {};
+        }
+    }
+    return readers;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "eeemcal_reader.h"
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Entries [first, last) of the events tree
+struct EntryRange {
+    Long64_t first;
+    Long64_t last;
+};
+
+// Split the tree into chunks of whole clusters with at least min_entries
+// entries each.  The layout only depends on the tree, never on the number of
+// threads, which is what makes the merged results independent of it.
+std::vector<EntryRange> make_entry_chunks(TTree *tree, Long64_t min_entries);
+
+// Resolve a requested thread count, 0 meaning one per core
+int resolve_thread_count(int n_threads);
+
+// Run `n_tasks` independent tasks on up to n_threads threads.  `task` is
+// called as task(task_index, thread_index).
+void parallel_for(int n_tasks, int n_threads, const std::function<void(int, int)> &task);
+
+// Run process(chunk, thread) for every chunk on up to n_threads threads and
+// hand the results to `merge` strictly in chunk order, as soon as they are
+// available, so only the chunks that finish out of order are held in memory.
+// With one thread this is a serial loop, and as long as the chunk layout does
+// not depend on the thread count neither does the merged result, bit for
+// bit.  A null result from `process` aborts the loop.
+template <class Result>
+bool ordered_reduce(int n_chunks, int n_threads,
+                    const std::function<std::unique_ptr<Result>(int, int)> &process,
+                    const std::function<void(Result &)> &merge) {
+    n_threads = std::min(resolve_thread_count(n_threads), std::max(n_chunks, 1));
+    if (n_threads > 1) {
+        ROOT::EnableThreadSafety();
+    }
+
+    std::vector<std::unique_ptr<Result>> results(n_chunks);
+    std::mutex merge_mutex;
+    int next_to_merge = 0;
+    std::atomic<bool> ok(true);
+    parallel_for(n_chunks, n_threads, [&](int chunk, int thread) {
+        if (!ok) {
+            return;
+        }
+        auto result = process(chunk, thread);
+        if (!result) {
+            ok = false;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        results[chunk] = std::move(result);
+        while (next_to_merge < n_chunks && results[next_to_merge]) {
+            merge(*results[next_to_merge]);
+            results[next_to_merge].reset();
+            next_to_merge++;
+        }
+    });
+    return ok && next_to_merge == n_chunks;
+}
+
+// A copy of the run file and its EventReader for one thread
+struct ThreadReader {
+    std::unique_ptr<TFile> file;
+    std::unique_ptr<EventReader> reader;
+};
+
+// Opens the run file once per thread, empty on error
+std::vector<ThreadReader> open_thread_readers(const std::string &file_name, int branches, int n_threads);
+
+// Event loop over the chunks of a run file, see ordered_reduce.  `process`
+// fills a fresh Result for one chunk from the reader of its thread.
+template <class Result>
+bool process_chunks(const std::string &file_name, int branches, const std::vector<EntryRange> &chunks, int n_threads,
+                    const std::function<std::unique_ptr<Result>(EventReader &, int)> &process,
+                    const std::function<void(Result &)> &merge) {
+    int n_chunks = chunks.size();
+    n_threads = std::min(resolve_thread_count(n_threads), std::max(n_chunks, 1));
+    std::vector<ThreadReader> readers = open_thread_readers(file_name, branches, n_threads);
+    if (readers.empty()) {
+        return false;
+    }
+    return ordered_reduce<Result>(n_chunks, n_threads,
+        [&](int chunk, int thread) {
+            EventReader &reader = *readers[thread].reader;
+            reader.set_entry_range(chunks[chunk].first, chunks[chunk].last);
+            return process(reader, chunk);
+        },
+        merge);
+}
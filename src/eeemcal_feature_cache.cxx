@@ -0,0 +1,149 @@
+#include "eeemcal_feature_cache.h"
+
+#include <TNamed.h>
+#include <TParameter.h>
+#include <TSystem.h>
+
+#include <algorithm>
+
+static const char *readout_names[NUM_READOUT_MODES] = {"16i", "4x4", "16p"};
+
+std::string feature_cache_dir(int run_number, int readout) {
+    return Form("output/Run%03d_features_%s", run_number, readout_names[readout]);
+}
+
+std::string feature_cache_chunk_path(const std::string &dir, int chunk) {
+    return Form("%s/chunk_%04d.root", dir.c_str(), chunk);
+}
+
+template <class T>
+static bool read_parameter(TFile &file, const char *name, T &value) {
+    TParameter<T> *parameter = nullptr;
+    file.GetObject(name, parameter);
+    if (!parameter) {
+        return false;
+    }
+    value = parameter->GetVal();
+    return true;
+}
+
+bool feature_cache_valid(const std::string &dir, const std::string &source_uuid, const std::vector<EntryRange> &chunks, const ChannelMap &channel_map) {
+    for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+        std::string path = feature_cache_chunk_path(dir, chunk);
+        if (gSystem->AccessPathName(path.c_str())) {
+            return false;
+        }
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str()));
+        if (!file || file->IsZombie()) {
+            return false;
+        }
+        int version = 0;
+        int readout = -1;
+        Long64_t first = -1;
+        Long64_t last = -1;
+        TNamed *uuid = nullptr;
+        TTree *tree = nullptr;
+        file->GetObject("source_uuid", uuid);
+        file->GetObject("features", tree);
+        if (!read_parameter(*file, "version", version) || !read_parameter(*file, "readout", readout)
+            || !read_parameter(*file, "first_entry", first) || !read_parameter(*file, "last_entry", last)
+            || !uuid || !tree) {
+            return false;
+        }
+        if (version != FEATURE_CACHE_VERSION || readout != channel_map.readout || source_uuid != uuid->GetTitle()
+            || first != chunks[chunk].first || last != chunks[chunk].last || tree->GetEntries() != last - first) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FeatureCacheWriter::FeatureCacheWriter(const std::string &path, const ChannelMap &channel_map)
+    : readout(channel_map.readout), n_channels(channel_map.n_mapped),
+      max_adc(n_channels), max_tot(n_channels), adc_at_tot(n_channels),
+      max_sample(n_channels), tot_sample(n_channels), n_tot(n_channels), noise(n_channels) {
+    file.reset(TFile::Open(path.c_str(), "RECREATE"));
+    if (!is_valid()) {
+        return;
+    }
+    tree = new TTree("features", "Calibration independent waveform features");
+    tree->SetDirectory(file.get());
+    tree->Branch("max_adc", max_adc.data(), Form("max_adc[%d]/s", n_channels));
+    tree->Branch("max_tot", max_tot.data(), Form("max_tot[%d]/s", n_channels));
+    tree->Branch("adc_at_tot", adc_at_tot.data(), Form("adc_at_tot[%d]/s", n_channels));
+    tree->Branch("max_sample", max_sample.data(), Form("max_sample[%d]/b", n_channels));
+    tree->Branch("tot_sample", tot_sample.data(), Form("tot_sample[%d]/b", n_channels));
+    tree->Branch("n_tot", n_tot.data(), Form("n_tot[%d]/b", n_channels));
+    tree->Branch("noise", noise.data(), Form("noise[%d]/F", n_channels));
+}
+
+void FeatureCacheWriter::fill(const WaveformFeatures &features) {
+    for (int i = 0; i < n_channels; i++) {
+        max_adc[i] = features.max_adc[i];
+        max_tot[i] = features.max_tot[i];
+        adc_at_tot[i] = features.adc_at_tot[i];
+        max_sample[i] = features.max_sample[i];
+        tot_sample[i] = features.tot_sample[i];
+        n_tot[i] = features.n_tot[i];
+        noise[i] = features.noise[i];
+    }
+    tree->Fill();
+}
+
+bool FeatureCacheWriter::close(const std::string &source_uuid, const EntryRange &range) {
+    if (!is_valid()) {
+        return false;
+    }
+    file->cd();
+    tree->Write();
+    TParameter<int>("version", FEATURE_CACHE_VERSION).Write();
+    TParameter<int>("readout", readout).Write();
+    TParameter<Long64_t>("first_entry", range.first).Write();
+    TParameter<Long64_t>("last_entry", range.last).Write();
+    TNamed("source_uuid", source_uuid.c_str()).Write();
+    file->Close();
+    file.reset();
+    return true;
+}
+
+FeatureCacheReader::FeatureCacheReader(const std::string &path, const ChannelMap &channel_map)
+    : n_channels(channel_map.n_mapped),
+      max_adc(n_channels), max_tot(n_channels), adc_at_tot(n_channels),
+      max_sample(n_channels), tot_sample(n_channels), n_tot(n_channels), noise(n_channels) {
+    file.reset(TFile::Open(path.c_str()));
+    if (!file || file->IsZombie()) {
+        return;
+    }
+    file->GetObject("features", tree);
+    if (!tree) {
+        return;
+    }
+    tree->SetBranchAddress("max_adc", max_adc.data());
+    tree->SetBranchAddress("max_tot", max_tot.data());
+    tree->SetBranchAddress("adc_at_tot", adc_at_tot.data());
+    tree->SetBranchAddress("max_sample", max_sample.data());
+    tree->SetBranchAddress("tot_sample", tot_sample.data());
+    tree->SetBranchAddress("n_tot", n_tot.data());
+    tree->SetBranchAddress("noise", noise.data());
+}
+
+bool FeatureCacheReader::get_entry(Long64_t entry, WaveformFeatures &features) {
+    if (tree->GetEntry(entry) <= 0) {
+        return false;
+    }
+    features.n_channels = n_channels;
+    for (int i = 0; i < n_channels; i++) {
+        features.pedestal[i] = 0;
+        features.noise[i] = noise[i];
+        features.max_adc[i] = max_adc[i];
+        features.max_tot[i] = max_tot[i];
+        features.adc_at_tot[i] = adc_at_tot[i];
+        features.max_sample[i] = max_sample[i];
+        features.tot_sample[i] = tot_sample[i];
+        features.toa_sample[i] = -1;
+        features.adc_at_toa[i] = 0;
+        features.n_tot[i] = n_tot[i];
+        features.n_toa[i] = 0;
+    }
+    return true;
+}
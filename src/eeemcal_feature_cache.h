@@ -0,0 +1,75 @@
+#pragma once
+
+#include "eeemcal_event_loop.h"
+#include "eeemcal_features.h"
+#include "eeemcal_mapping.h"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Per-run cache of the calibration independent features of every event and
+// mapped channel: pedestal subtracted max ADC, max ToT, the ADC at the ToT
+// sample, the sample indices, the ToT hit count and the pedestal noise the
+// hit thresholds depend on.  The TOA branch is not
+// read for it, so TOA features read back as empty.  Re-applying a gain or ToT
+// calibration only needs these, so a rerun reads a few percent of the bytes
+// of the waveforms and skips the feature extraction.
+//
+// The cache is a directory with one file per chunk of the event loop
+// (chunk_NNNN.root), so the threads of the loop write and read it
+// independently.  Every file records the UUID of the run file and the entry
+// range it covers, and a cache only counts as valid if it matches the run
+// file and its chunk layout exactly.
+
+// 2: max ADC minus the tracked pedestal instead of sample 0
+// 3: pedestal noise
+// 4: pedestals per block with a warm-up, see eeemcal_pedestal.h
+const int FEATURE_CACHE_VERSION = 4;
+
+std::string feature_cache_dir(int run_number, int readout);
+std::string feature_cache_chunk_path(const std::string &dir, int chunk);
+
+// True if `dir` holds a complete cache of `chunks` of the run file with `source_uuid`
+bool feature_cache_valid(const std::string &dir, const std::string &source_uuid, const std::vector<EntryRange> &chunks, const ChannelMap &channel_map);
+
+// Writes the features of one chunk
+class FeatureCacheWriter {
+public:
+    FeatureCacheWriter(const std::string &path, const ChannelMap &channel_map);
+
+    bool is_valid() const { return file && !file->IsZombie(); }
+    void fill(const WaveformFeatures &features);
+    bool close(const std::string &source_uuid, const EntryRange &range);
+
+private:
+    int readout;
+    int n_channels;
+    std::unique_ptr<TFile> file;
+    TTree *tree = nullptr;
+    std::vector<UShort_t> max_adc, max_tot, adc_at_tot;
+    std::vector<UChar_t> max_sample, tot_sample, n_tot;
+    std::vector<Float_t> noise;
+};
+
+// Reads the features of one chunk back into WaveformFeatures.  The
+// pedestal is not cached and reads back as 0, and there is no TOA.
+class FeatureCacheReader {
+public:
+    FeatureCacheReader(const std::string &path, const ChannelMap &channel_map);
+
+    bool is_valid() const { return tree != nullptr; }
+    Long64_t n_entries() const { return tree->GetEntries(); }
+    bool get_entry(Long64_t entry, WaveformFeatures &features);
+
+private:
+    int n_channels;
+    std::unique_ptr<TFile> file;
+    TTree *tree = nullptr;
+    std::vector<UShort_t> max_adc, max_tot, adc_at_tot;
+    std::vector<UChar_t> max_sample, tot_sample, n_tot;
+    std::vector<Float_t> noise;
+};
@@ -0,0 +1,101 @@
+#include "eeemcal_features.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const int BLOCK_SIZE = 64;
+
+// Copy the samples of up to BLOCK_SIZE channels into sample-major order
+static void gather_block(const uint waveform[NUM_CHANNELS][NUM_SAMPLES], const int *channels, int n,
+                         int block[NUM_SAMPLES][BLOCK_SIZE]) {
+    for (int lane = 0; lane < n; lane++) {
+        const uint *samples = waveform[channels[lane]];
+        for (int sample = 0; sample < NUM_SAMPLES; sample++) {
+            block[sample][lane] = samples[sample];
+        }
+    }
+    for (int lane = n; lane < BLOCK_SIZE; lane++) {
+        for (int sample = 0; sample < NUM_SAMPLES; sample++) {
+            block[sample][lane] = 0;
+        }
+    }
+}
+
+void extract_features(const uint adc[NUM_CHANNELS][NUM_SAMPLES],
+                      const uint tot[NUM_CHANNELS][NUM_SAMPLES],
+                      const uint toa[NUM_CHANNELS][NUM_SAMPLES],
+                      const ChannelMap &channel_map,
+                      const PedestalSnapshot &pedestals,
+                      WaveformFeatures &features) {
+    alignas(64) int adc_block[NUM_SAMPLES][BLOCK_SIZE];
+    alignas(64) int tot_block[NUM_SAMPLES][BLOCK_SIZE];
+    alignas(64) int toa_block[NUM_SAMPLES][BLOCK_SIZE];
+    alignas(64) int best_adc[BLOCK_SIZE], best_adc_sample[BLOCK_SIZE];
+    alignas(64) int best_tot[BLOCK_SIZE], best_tot_sample[BLOCK_SIZE];
+    alignas(64) int first_toa[BLOCK_SIZE], tot_hits[BLOCK_SIZE], toa_hits[BLOCK_SIZE];
+
+    features.n_channels = channel_map.n_mapped;
+    for (int first = 0; first < channel_map.n_mapped; first += BLOCK_SIZE) {
+        int n = std::min(BLOCK_SIZE, channel_map.n_mapped - first);
+        const int *channels = channel_map.channel + first;
+
+        gather_block(adc, channels, n, adc_block);
+        if (tot) {
+            gather_block(tot, channels, n, tot_block);
+        } else {
+            std::fill(&tot_block[0][0], &tot_block[0][0] + NUM_SAMPLES * BLOCK_SIZE, 0);
+        }
+        if (toa) {
+            gather_block(toa, channels, n, toa_block);
+        } else {
+            std::fill(&toa_block[0][0], &toa_block[0][0] + NUM_SAMPLES * BLOCK_SIZE, 0);
+        }
+
+        #pragma omp simd
+        for (int lane = 0; lane < BLOCK_SIZE; lane++) {
+            best_adc[lane] = adc_block[0][lane];
+            best_adc_sample[lane] = 0;
+            best_tot[lane] = 0;
+            best_tot_sample[lane] = 0;
+            first_toa[lane] = -1;
+            tot_hits[lane] = 0;
+            toa_hits[lane] = 0;
+        }
+        // Strict comparisons keep the first sample of a tied maximum, like
+        // the scalar loops this replaces
+        for (int sample = 0; sample < NUM_SAMPLES; sample++) {
+            #pragma omp simd
+            for (int lane = 0; lane < BLOCK_SIZE; lane++) {
+                int a = adc_block[sample][lane];
+                int t = tot_block[sample][lane];
+                int o = toa_block[sample][lane];
+                bool adc_higher = a > best_adc[lane];
+                best_adc[lane] = adc_higher ? a : best_adc[lane];
+                best_adc_sample[lane] = adc_higher ? sample : best_adc_sample[lane];
+                bool tot_higher = t > best_tot[lane];
+                best_tot[lane] = tot_higher ? t : best_tot[lane];
+                best_tot_sample[lane] = tot_higher ? sample : best_tot_sample[lane];
+                tot_hits[lane] += t > 0;
+                toa_hits[lane] += o > 0;
+                first_toa[lane] = (first_toa[lane] < 0 && o > 0) ? sample : first_toa[lane];
+            }
+        }
+
+        for (int lane = 0; lane < n; lane++) {
+            int i = first + lane;
+            float tracked = pedestals.pedestal[channels[lane]];
+            int pedestal = std::lround(tracked);
+            features.pedestal[i] = tracked;
+            features.noise[i] = pedestals.noise[channels[lane]];
+            features.max_adc[i] = std::max(best_adc[lane] - pedestal, 0);
+            features.max_sample[i] = best_adc_sample[lane];
+            features.adc_at_tot[i] = adc_block[best_tot_sample[lane]][lane];
+            features.max_tot[i] = best_tot[lane];
+            features.tot_sample[i] = best_tot_sample[lane];
+            features.toa_sample[i] = first_toa[lane];
+            features.adc_at_toa[i] = first_toa[lane] >= 0 ? adc_block[first_toa[lane]][lane] - pedestal : 0;
+            features.n_tot[i] = tot_hits[lane];
+            features.n_toa[i] = toa_hits[lane];
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "eeemcal_mapping.h"
+#include "eeemcal_pedestal.h"
+
+#include <sys/types.h>
+
+// Per channel waveform features of one event.  Structure of arrays over the
+// mapped channels of a ChannelMap, indexed like ChannelMap::channel
+// (crystal * n_sipms + sipm).
+struct WaveformFeatures {
+    int n_channels = 0;
+    alignas(64) float pedestal[MAX_MAPPED_CHANNELS];    // tracked pedestal, see PedestalTracker
+    alignas(64) float noise[MAX_MAPPED_CHANNELS];       // tracked pedestal noise
+    alignas(64) float max_adc[MAX_MAPPED_CHANNELS];     // minus the rounded pedestal, >= 0
+    alignas(64) int max_sample[MAX_MAPPED_CHANNELS];    // first sample with the max ADC
+    alignas(64) int adc_at_tot[MAX_MAPPED_CHANNELS];    // raw ADC at tot_sample
+    alignas(64) int max_tot[MAX_MAPPED_CHANNELS];
+    alignas(64) int tot_sample[MAX_MAPPED_CHANNELS];    // first sample with the max ToT
+    alignas(64) int toa_sample[MAX_MAPPED_CHANNELS];    // first sample with a TOA, -1 if none
+    alignas(64) int adc_at_toa[MAX_MAPPED_CHANNELS];    // pedestal subtracted ADC at toa_sample, 0 if none
+    alignas(64) int n_tot[MAX_MAPPED_CHANNELS];         // samples with ToT > 0
+    alignas(64) int n_toa[MAX_MAPPED_CHANNELS];         // samples with TOA > 0
+};
+
+// Single pass over the samples of all mapped channels of an event.  The
+// channels are gathered into small sample-major blocks so the per sample
+// updates run across channels in SIMD lanes.  tot and toa may be null, in
+// which case their features are zero (toa_sample -1).  The pedestals are
+// those of the tracker after it has seen the event; they are rounded to
+// whole ADC counts before the subtraction, so the ADC features stay integers.
+void extract_features(const uint adc[NUM_CHANNELS][NUM_SAMPLES],
+                      const uint tot[NUM_CHANNELS][NUM_SAMPLES],
+                      const uint toa[NUM_CHANNELS][NUM_SAMPLES],
+                      const ChannelMap &channel_map,
+                      const PedestalSnapshot &pedestals,
+                      WaveformFeatures &features);
@@ -0,0 +1,97 @@
+#include "eeemcal_fit.h"
+#include "eeemcal_event_loop.h"
+
+#include <Math/Factory.h>
+#include <Math/Minimizer.h>
+#include <Math/MinimizerOptions.h>
+#include <TList.h>
+#include <TROOT.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+double crystal_ball(double *inputs, double *par) {
+    // Parameters
+    // alpha: Where the gaussian transitions to the power law tail - fix?
+    // n: The exponent of the power law tail - fix?
+    // x_bar: The mean of the gaussian - free
+    // sigma: The width of the gaussian - fix ?
+    // N: The normalization of the gaussian - free
+    // B baseline - fix?
+
+    double x = inputs[0];
+
+    double alpha = par[0];
+    double n = par[1];
+    double x_bar = par[2];
+    double sigma = par[3];
+    double N = par[4];
+    double offset = par[5];
+    // add an exponential decay 
+    
+    double A = pow(n / fabs(alpha), n) * exp(-0.5 * alpha * alpha);
+    double B = n / fabs(alpha) - fabs(alpha);
+    // std::cout << "A: " << A << std::endl;
+
+    // std::cout << "alpha: " << alpha << " n: " << n << " x_bar: " << x_bar << " sigma: " << sigma << " N: " << N << " B: " << B << " A: " << A << std::endl;
+
+    double ret_val;
+    if ((x - x_bar) / sigma > -1 * alpha) {
+        // std::cout << "path a" << std::endl;
+        ret_val = exp((-0.5 * (x - x_bar) * (x - x_bar)) / (sigma * sigma));
+    } else {
+        // std::cout << "path b" << std::endl;
+        ret_val = A * pow(B - ((x - x_bar) / sigma), -1 * n);
+    }
+    ret_val = N * ret_val + offset;
+    // std::cout << "x: " << x << " y: " << ret_val << std::endl;
+    return ret_val;
+}
+
+TF1* create_fit_function(const char* name, double lower_range, double upper_range) {
+    auto fit = new TF1(name, crystal_ball, lower_range, upper_range, 6, 1, TF1::EAddToList::kNo);
+    fit->SetParNames("alpha", "n", "x_bar", "sigma", "N", "offset");
+    fit->SetParameters(0.5, 1, 250, 100, 10, 0);
+
+    fit->SetParLimits(0, 0.01, 1);
+    fit->SetParLimits(1, 0.01, 10);
+    fit->SetParLimits(2, 125, 1000);
+    fit->SetParLimits(3, 20, 1000);
+    fit->SetParLimits(4, 0, 5000);
+    fit->SetParLimits(5, 0, 10);
+    return fit;
+    // return new TF1(name, "gaus", lower_range, upper_range);
+}
+
+std::vector<FitResult> run_fits(const std::vector<FitTask> &tasks, int n_threads) {
+    int n_tasks = tasks.size();
+    n_threads = std::min(resolve_thread_count(n_threads), std::max(n_tasks, 1));
+    if (n_threads > 1) {
+        ROOT::EnableThreadSafety();
+    }
+    // TMinuit, the default minimizer of TH1::Fit, keeps global state.  Minuit2
+    // does not, and is used for any number of threads so the results do not
+    // depend on it.  Creating one here loads the plugin before the threads do.
+    ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+    delete ROOT::Math::Factory::CreateMinimizer("Minuit2");
+
+    std::vector<FitResult> results(n_tasks);
+    parallel_for(n_tasks, n_threads, [&](int task, int thread) {
+        std::string name = "fit_" + std::to_string(task);
+        std::unique_ptr<TF1> function(tasks[task].make_function(name.c_str()));
+        if (tasks[task].fitter) {
+            results[task].status = tasks[task].fitter(tasks[task].hist, function.get());
+        } else {
+            std::string options = std::string(tasks[task].options) + "N";
+            results[task].status = tasks[task].hist->Fit(function.get(), options.c_str());
+        }
+        results[task].function = function.release();
+    });
+
+    for (int task = 0; task < n_tasks; task++) {
+        results[task].function->SetName("fit");
+        tasks[task].hist->GetListOfFunctions()->Add(results[task].function);
+    }
+    return results;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <TF1.h>
+#include <TH1.h>
+
+#include <functional>
+#include <vector>
+
+double crystal_ball(double *inputs, double *par);
+// The function is not added to the global list of functions, so fit it by
+// pointer rather than by name
+TF1* create_fit_function(const char* name, double lower_range, double upper_range);
+
+// One independent fit: make_function(name) builds the function to fit,
+// with its range, start values and limits, under the given unique name.  It
+// is fitted with TH1::Fit and `options`, or with `fitter` if set (e.g.
+// fit_crystal_ball), which returns the fit status.
+struct FitTask {
+    TH1 *hist;
+    std::function<TF1*(const char*)> make_function;
+    const char *options = "RQ";
+    std::function<int(TH1*, TF1*)> fitter;
+};
+
+struct FitResult {
+    TF1 *function = nullptr;   // fitted function, stored on the histogram as "fit"
+    int status = -1;           // TFitResultPtr status, 0 on success
+};
+
+// Run the fits on up to n_threads threads (0 for one per core), each with its
+// own function and minimizer.  The results are in task order and identical
+// for any number of threads.  Afterwards every function is renamed "fit" and
+// attached to its histogram on the calling thread, so GetFunction("fit") and
+// Draw work as after a plain TH1::Fit.
+std::vector<FitResult> run_fits(const std::vector<FitTask> &tasks, int n_threads);
@@ -0,0 +1,135 @@
+#include "eeemcal_fit_seeds.h"
+
+#include <TString.h>
+#include <TSystem.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+FitSeeds::FitSeeds(double beam_energy) : beam_energy(beam_energy) {}
+
+// Is a seed at energy `candidate` a better match for `target` than `current`?
+static bool closer_in_energy(double target, double candidate, int candidate_run, double current, int current_run) {
+    double candidate_distance = std::fabs(std::log(candidate / target));
+    double current_distance = std::fabs(std::log(current / target));
+    if (candidate_distance != current_distance) {
+        return candidate_distance < current_distance;
+    }
+    return candidate_run > current_run;
+}
+
+void FitSeeds::load(int before_run) {
+    seeds.clear();
+    if (beam_energy <= 0) {
+        return;
+    }
+    void *dir = gSystem->OpenDirectory(FIT_SEED_DIR);
+    if (!dir) {
+        return;
+    }
+    while (const char *entry = gSystem->GetDirEntry(dir)) {
+        int run_number;
+        // Only finished files, never the temporary of a save in progress
+        char suffix[8] = "";
+        if (std::sscanf(entry, "Run%d.%7s", &run_number, suffix) != 2 || std::string(suffix) != "tsv") {
+            continue;
+        }
+        if (before_run >= 0 && run_number >= before_run) {
+            continue;
+        }
+        std::ifstream file(Form("%s/%s", FIT_SEED_DIR, entry));
+        double run_energy = 0;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            std::string key;
+            if (!(fields >> key) || key[0] == '#') {
+                continue;
+            }
+            if (key == "beam_energy") {
+                fields >> run_energy;
+                continue;
+            }
+            if (run_energy <= 0 || std::max(run_energy / beam_energy, beam_energy / run_energy) > MAX_SEED_ENERGY_RATIO) {
+                break;
+            }
+            std::vector<double> parameters;
+            double value;
+            while (fields >> value) {
+                parameters.push_back(value);
+            }
+            auto seed = seeds.find(key);
+            if (seed == seeds.end() || closer_in_energy(beam_energy, run_energy, run_number, seed->second.beam_energy, seed->second.run_number)) {
+                seeds[key] = {run_number, run_energy, parameters};
+            }
+        }
+    }
+    gSystem->FreeDirectory(dir);
+}
+
+bool FitSeeds::apply(const std::string &key, TF1 *function) const {
+    auto seed = seeds.find(key);
+    if (seed == seeds.end() || (int)seed->second.parameters.size() != function->GetNpar()) {
+        return false;
+    }
+    double ratio = beam_energy / seed->second.beam_energy;
+    for (int par = 0; par < function->GetNpar(); par++) {
+        double value = seed->second.parameters[par];
+        // Crystal ball peak position and width
+        if (par == 2) {
+            value *= ratio;
+        } else if (par == 3) {
+            value *= std::sqrt(ratio);
+        }
+        double lower, upper;
+        function->GetParLimits(par, lower, upper);
+        if (lower < upper) {
+            value = std::min(std::max(value, lower), upper);
+        }
+        function->SetParameter(par, value);
+    }
+    return true;
+}
+
+void FitSeeds::record(const std::string &key, const TF1 *function) {
+    std::vector<double> parameters(function->GetNpar());
+    for (int par = 0; par < function->GetNpar(); par++) {
+        parameters[par] = function->GetParameter(par);
+    }
+    results[key] = parameters;
+}
+
+bool FitSeeds::save(int run_number) const {
+    if (beam_energy <= 0 || results.empty()) {
+        return false;
+    }
+    gSystem->mkdir(FIT_SEED_DIR, true);
+    // Through a temporary file that replaces the old one in one rename, so
+    // the jobs of other runs loading the directory never read half a file
+    std::string path = Form("%s/Run%03d.tsv", FIT_SEED_DIR, run_number);
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path);
+    if (!file) {
+        std::cerr << "Error writing " << tmp_path << std::endl;
+        return false;
+    }
+    file.precision(10);
+    file << "beam_energy\t" << beam_energy << "\n";
+    for (auto &result : results) {
+        file << result.first;
+        for (double value : result.second) {
+            file << "\t" << value;
+        }
+        file << "\n";
+    }
+    file.close();
+    if (!file || gSystem->Rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+    return true;
+}
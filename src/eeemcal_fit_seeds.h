@@ -0,0 +1,52 @@
+#pragma once
+
+#include <TF1.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Converged fit parameters of earlier runs, used as start values of the same
+// fit (same key, e.g. "crystal_single_07") in later runs.
+//
+// Each run writes output/fit_seeds/RunNNN.tsv: a "beam_energy <GeV>" line,
+// then one "<key> <parameters...>" line per converged fit.  Every fit takes
+// its seed from the run closest in beam energy that has one, among the runs
+// with a lower number, within a factor MAX_SEED_ENERGY_RATIO, and the latest
+// of those on a tie.  So the seeds of a run do not depend on which runs were
+// processed before it, or on whether it was processed itself.  Peak positions
+// are scaled with the energy ratio and widths with its square root before
+// they are clamped to the limits of the function.  Fits without a seed keep
+// their defaults.
+
+const char *const FIT_SEED_DIR = "output/fit_seeds";
+const double MAX_SEED_ENERGY_RATIO = 2;
+
+class FitSeeds {
+public:
+    // Seeds for a run at beam_energy, <= 0 if unknown, which disables seeding
+    FitSeeds(double beam_energy);
+
+    // Read the seeds of the runs before `before_run` from FIT_SEED_DIR, of
+    // all runs for a negative before_run (merged runs)
+    void load(int before_run);
+    // Overwrite the start values of `function` with the seed of `key`.  The
+    // crystal ball x_bar and sigma are scaled to this run's energy.  Safe to
+    // call from several threads once loaded.  Returns false if there is no seed.
+    bool apply(const std::string &key, TF1 *function) const;
+
+    // Remember the result of a converged fit of this run
+    void record(const std::string &key, const TF1 *function);
+    // Write the recorded results to FIT_SEED_DIR/RunNNN.tsv
+    bool save(int run_number) const;
+
+private:
+    struct Seed {
+        int run_number;
+        double beam_energy;
+        std::vector<double> parameters;
+    };
+    double beam_energy;
+    std::map<std::string, Seed> seeds;
+    std::map<std::string, std::vector<double>> results;
+};
@@ -0,0 +1,150 @@
+#include "eeemcal_follow.h"
+#include "eeemcal_pedestal.h"
+
+#include <TFile.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+using follow_clock = std::chrono::steady_clock;
+
+static double seconds_since(follow_clock::time_point start) {
+    return std::chrono::duration<double>(follow_clock::now() - start).count();
+}
+
+static void sleep_seconds(double seconds) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+// Wait for the decoder to create the file and write the first tree header
+static TTree *wait_for_tree(const std::string &file_name, const FollowOptions &options, std::unique_ptr<TFile> &file) {
+    auto start = follow_clock::now();
+    while (seconds_since(start) < options.idle_seconds) {
+        if (!gSystem->AccessPathName(file_name.c_str())) {
+            file.reset(TFile::Open(file_name.c_str()));
+            TTree *tree = nullptr;
+            if (file && !file->IsZombie()) {
+                file->GetObject("events", tree);
+            }
+            if (tree) {
+                return tree;
+            }
+        }
+        sleep_seconds(options.poll_seconds);
+    }
+    std::cerr << "No events tree in " << file_name << " after " << options.idle_seconds << " s" << std::endl;
+    return nullptr;
+}
+
+std::string follow_done_marker(const std::string &file_name) {
+    return file_name + ".done";
+}
+
+FollowStatus follow_run(const std::string &file_name, int branches, const FollowOptions &options,
+                        const std::function<bool(EventReader &, Long64_t, Long64_t)> &process,
+                        const std::function<void()> &write) {
+    std::unique_ptr<TFile> file;
+    TTree *tree = wait_for_tree(file_name, options, file);
+    if (!tree) {
+        return FOLLOW_ERROR;
+    }
+    EventReader reader(tree, branches);
+    if (!reader.is_valid()) {
+        return FOLLOW_ERROR;
+    }
+
+    std::string done_marker = follow_done_marker(file_name);
+    Long64_t processed = 0;
+    auto last_new_entries = follow_clock::now();
+    auto last_write = follow_clock::now();
+    FollowStatus status = FOLLOW_IDLE;
+    while (true) {
+        // Check the marker before refreshing the tree, so everything the
+        // producer wrote before creating it is seen by this pass
+        bool done = !gSystem->AccessPathName(done_marker.c_str());
+        tree->Refresh();
+        // Until the run is done, the events of a pedestal block wait for its
+        // warm-up, so they get the pedestals of the offline pass
+        Long64_t n_entries = done ? reader.n_entries() : pedestal_ready_entries(reader.n_entries());
+        while (processed < n_entries) {
+            Long64_t last = std::min(n_entries, processed + options.chunk_entries);
+            reader.set_entry_range(processed, last);
+            if (!process(reader, processed, last)) {
+                write();
+                return FOLLOW_ERROR;
+            }
+            processed = last;
+            last_new_entries = follow_clock::now();
+            if (seconds_since(last_write) >= options.write_seconds) {
+                write();
+                last_write = follow_clock::now();
+                std::cout << "Processed " << processed << " events" << std::endl;
+            }
+        }
+        if (done) {
+            status = FOLLOW_DONE;
+            break;
+        }
+        if (seconds_since(last_write) >= options.write_seconds) {
+            write();
+            last_write = follow_clock::now();
+        }
+        if (seconds_since(last_new_entries) >= options.idle_seconds) {
+            std::cerr << "No new events in " << file_name << " for " << options.idle_seconds << " s, stopping" << std::endl;
+            break;
+        }
+        sleep_seconds(options.poll_seconds);
+    }
+    write();
+    std::cout << "Processed " << processed << " events" << std::endl;
+    return status;
+}
+
+bool write_online_file(const std::string &path, const std::vector<TObject*> &objects) {
+    std::string tmp_path = path + ".tmp";
+    std::unique_ptr<TFile> file(TFile::Open(tmp_path.c_str(), "RECREATE"));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error writing " << tmp_path << std::endl;
+        return false;
+    }
+    file->cd();
+    for (auto object : objects) {
+        object->Write();
+    }
+    file->Close();
+    return gSystem->Rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+const char *const FOLLOW_USAGE =
+    "  --follow  process the run file while it is written, rewriting the online summary\n"
+    "  --poll S, --write-interval S, --idle S  poll and rewrite intervals, stop after S s without new events\n"
+    "  --chunk N  process at most N new events between checks of the rewrite interval\n";
+
+bool parse_follow_option(int argc, char **argv, int &i, bool &follow, FollowOptions &options) {
+    if (strcmp(argv[i], "--follow") == 0) {
+        follow = true;
+        return true;
+    }
+    if (i + 1 >= argc) {
+        return false;
+    }
+    if (strcmp(argv[i], "--poll") == 0) {
+        options.poll_seconds = std::atof(argv[++i]);
+    } else if (strcmp(argv[i], "--write-interval") == 0) {
+        options.write_seconds = std::atof(argv[++i]);
+    } else if (strcmp(argv[i], "--idle") == 0) {
+        options.idle_seconds = std::atof(argv[++i]);
+    } else if (strcmp(argv[i], "--chunk") == 0) {
+        options.chunk_entries = std::max(1LL, std::atoll(argv[++i]));
+    } else {
+        return false;
+    }
+    return true;
+}
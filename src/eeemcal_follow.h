@@ -0,0 +1,45 @@
+#pragma once
+
+#include "eeemcal_reader.h"
+
+#include <TObject.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Online mode: follow a run file while the decoder is still writing it.
+// The events tree is refreshed from the file every poll_seconds, only the
+// entries added since the last poll are processed, at most chunk_entries at
+// a time, and the summary outputs are rewritten every write_seconds and once
+// more at the end.
+//
+// The run is complete once the producer has created the done marker,
+// "<run file>.done", and every entry written before it has been processed.
+// Without a marker the loop gives up after idle_seconds without new entries.
+struct FollowOptions {
+    double poll_seconds = 5;
+    double write_seconds = 30;
+    double idle_seconds = 600;
+    Long64_t chunk_entries = 20000;
+};
+
+enum FollowStatus { FOLLOW_ERROR, FOLLOW_IDLE, FOLLOW_DONE };
+
+std::string follow_done_marker(const std::string &file_name);
+
+// process(reader, first, last) handles entries [first, last) and returns
+// false on error, which stops the loop.  write() rewrites the outputs.
+FollowStatus follow_run(const std::string &file_name, int branches, const FollowOptions &options,
+                const std::function<bool(EventReader &, Long64_t, Long64_t)> &process,
+                const std::function<void()> &write);
+
+// Write `objects` to path through a temporary file that replaces it in one
+// rename, so a viewer never opens a half written file
+bool write_online_file(const std::string &path, const std::vector<TObject*> &objects);
+
+// Command line options of the executables for the online mode: --follow,
+// --poll S, --write-interval S, --idle S and --chunk N.  Returns true if argv[i] is one
+// of them, advancing i past its value; `follow` is set by --follow.
+bool parse_follow_option(int argc, char **argv, int &i, bool &follow, FollowOptions &options);
+extern const char *const FOLLOW_USAGE;
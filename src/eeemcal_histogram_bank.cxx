@@ -0,0 +1,178 @@
+#include "eeemcal_histogram_bank.h"
+
+#include <TVectorD.h>
+#include <TVectorF.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+// Read <name>_layout, <name>_counts and <name>_stats, checking the layout
+// against `layout` and the sizes against the bank's
+template <class Counts>
+static bool read_bank(TDirectory *dir, const std::string &name, const std::vector<double> &layout,
+                      std::unique_ptr<Counts> &counts, size_t n_counts,
+                      std::unique_ptr<TVectorD> &stats, size_t n_stats) {
+    TVectorD *file_layout = nullptr;
+    Counts *file_counts = nullptr;
+    TVectorD *file_stats = nullptr;
+    dir->GetObject((name + "_layout").c_str(), file_layout);
+    dir->GetObject((name + "_counts").c_str(), file_counts);
+    dir->GetObject((name + "_stats").c_str(), file_stats);
+    std::unique_ptr<TVectorD> owned_layout(file_layout);
+    counts.reset(file_counts);
+    stats.reset(file_stats);
+    if (!file_layout || !file_counts || !file_stats) {
+        std::cerr << "Error getting " << name << " from " << dir->GetName() << std::endl;
+        return false;
+    }
+    bool same_layout = file_layout->GetNrows() == (int)layout.size();
+    for (size_t i = 0; same_layout && i < layout.size(); i++) {
+        same_layout = (*file_layout)[i] == layout[i];
+    }
+    if (!same_layout || file_counts->GetNrows() != (int)n_counts || file_stats->GetNrows() != (int)n_stats) {
+        std::cerr << "Binning of " << name << " in " << dir->GetName() << " does not match" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <class Counts, class Value>
+static void write_bank(const std::string &name, const std::vector<double> &layout,
+                       const std::vector<Value> &counts, const std::vector<double> &stats) {
+    TVectorD file_layout(layout.size());
+    std::copy(layout.begin(), layout.end(), file_layout.GetMatrixArray());
+    Counts file_counts(counts.size());
+    std::copy(counts.begin(), counts.end(), file_counts.GetMatrixArray());
+    TVectorD file_stats(stats.size());
+    std::copy(stats.begin(), stats.end(), file_stats.GetMatrixArray());
+    file_layout.Write((name + "_layout").c_str());
+    file_counts.Write((name + "_counts").c_str());
+    file_stats.Write((name + "_stats").c_str());
+}
+
+HistogramBank1D::HistogramBank1D(int n_hists, int n_bins, double low, double high)
+    : hists(n_hists), n_bins(n_bins), low(low), high(high), stride(n_bins + 2),
+      counts(n_hists * stride, 0), stats(n_hists * N_STATS, 0) {}
+
+void HistogramBank1D::pad(Long64_t n_entries, double value) {
+    int bin = find_bin(value);
+    bool in_range = bin > 0 && bin <= n_bins;
+    for (int hist = 0; hist < hists; hist++) {
+        double *hist_stats = &stats[hist * N_STATS];
+        double missing = n_entries - hist_stats[ENTRIES];
+        if (missing <= 0) {
+            continue;
+        }
+        counts[hist * stride + bin] += missing;
+        hist_stats[ENTRIES] += missing;
+        if (in_range) {
+            hist_stats[SUMW] += missing;
+            hist_stats[SUMW2] += missing;
+            hist_stats[SUMWX] += missing * value;
+            hist_stats[SUMWX2] += missing * value * value;
+        }
+    }
+}
+
+void HistogramBank1D::add(const HistogramBank1D &other) {
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+    for (size_t i = 0; i < stats.size(); i++) {
+        stats[i] += other.stats[i];
+    }
+}
+
+void HistogramBank1D::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(stats.begin(), stats.end(), 0);
+}
+
+void HistogramBank1D::write(const std::string &name) const {
+    write_bank<TVectorD>(name, {double(hists), double(n_bins), low, high}, counts, stats);
+}
+
+bool HistogramBank1D::add_from(TDirectory *dir, const std::string &name) {
+    std::unique_ptr<TVectorD> file_counts, file_stats;
+    if (!read_bank(dir, name, {double(hists), double(n_bins), low, high}, file_counts, counts.size(), file_stats, stats.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += (*file_counts)[i];
+    }
+    for (size_t i = 0; i < stats.size(); i++) {
+        stats[i] += (*file_stats)[i];
+    }
+    return true;
+}
+
+TH1D *HistogramBank1D::to_th1(int hist, const char *name, const char *title) const {
+    TH1D *th1 = new TH1D(name, title, n_bins, low, high);
+    th1->SetDirectory(nullptr);
+    const double *hist_counts = &counts[hist * stride];
+    for (int bin = 0; bin < stride; bin++) {
+        th1->SetBinContent(bin, hist_counts[bin]);
+    }
+    // SetBinContent resets the statistics, so restore them afterwards
+    const double *hist_stats = &stats[hist * N_STATS];
+    double th1_stats[4] = {hist_stats[SUMW], hist_stats[SUMW2], hist_stats[SUMWX], hist_stats[SUMWX2]};
+    th1->PutStats(th1_stats);
+    th1->SetEntries(hist_stats[ENTRIES]);
+    return th1;
+}
+
+HistogramBank2D::HistogramBank2D(int n_hists, int n_bins_x, double low_x, double high_x, int n_bins_y, double low_y, double high_y)
+    : hists(n_hists), n_bins_x(n_bins_x), n_bins_y(n_bins_y),
+      low_x(low_x), high_x(high_x), low_y(low_y), high_y(high_y),
+      stride((n_bins_x + 2) * (n_bins_y + 2)),
+      counts(n_hists * stride, 0), stats(n_hists * N_STATS, 0) {}
+
+void HistogramBank2D::add(const HistogramBank2D &other) {
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+    for (size_t i = 0; i < stats.size(); i++) {
+        stats[i] += other.stats[i];
+    }
+}
+
+void HistogramBank2D::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(stats.begin(), stats.end(), 0);
+}
+
+void HistogramBank2D::write(const std::string &name) const {
+    write_bank<TVectorF>(name, {double(hists), double(n_bins_x), low_x, high_x, double(n_bins_y), low_y, high_y}, counts, stats);
+}
+
+bool HistogramBank2D::add_from(TDirectory *dir, const std::string &name) {
+    std::unique_ptr<TVectorF> file_counts;
+    std::unique_ptr<TVectorD> file_stats;
+    if (!read_bank(dir, name, {double(hists), double(n_bins_x), low_x, high_x, double(n_bins_y), low_y, high_y},
+                   file_counts, counts.size(), file_stats, stats.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += (*file_counts)[i];
+    }
+    for (size_t i = 0; i < stats.size(); i++) {
+        stats[i] += (*file_stats)[i];
+    }
+    return true;
+}
+
+TH2F *HistogramBank2D::to_th2(int hist, const char *name, const char *title) const {
+    TH2F *th2 = new TH2F(name, title, n_bins_x, low_x, high_x, n_bins_y, low_y, high_y);
+    th2->SetDirectory(nullptr);
+    const float *hist_counts = &counts[hist * stride];
+    for (int bin = 0; bin < stride; bin++) {
+        th2->SetBinContent(bin, hist_counts[bin]);
+    }
+    const double *hist_stats = &stats[hist * N_STATS];
+    double th2_stats[7] = {hist_stats[SUMW], hist_stats[SUMW2], hist_stats[SUMWX], hist_stats[SUMWX2],
+                           hist_stats[SUMWY], hist_stats[SUMWY2], hist_stats[SUMWXY]};
+    th2->PutStats(th2_stats);
+    th2->SetEntries(hist_stats[ENTRIES]);
+    return th2;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <TH1D.h>
+#include <TH2F.h>
+#include <TDirectory.h>
+
+#include <string>
+#include <vector>
+
+// Banks of histograms with a shared binning, for the per channel spectra.
+// The bins of all histograms live in one contiguous array, in ROOT's bin
+// numbering (0 underflow, n_bins + 1 overflow), and the fills keep the same
+// statistics as TH1::Fill, so to_th1/to_th2 give exactly the histogram the
+// same fills of a TH1D/TH2F would.  Filling is a plain array update with no
+// virtual call or name lookup; the banks are cheap to create per thread and
+// to merge, and only become ROOT histograms for fitting and output.
+//
+// For the per run accumulator files a bank is written to a directory as
+// <name>_layout (binning), <name>_counts and <name>_stats, and add_from adds
+// a bank written that way, failing if it is missing or binned differently.
+
+class HistogramBank1D {
+public:
+    HistogramBank1D(int n_hists, int n_bins, double low, double high);
+
+    int n_hists() const { return hists; }
+
+    void fill(int hist, double value) {
+        int bin = find_bin(value);
+        counts[hist * stride + bin] += 1;
+        // Like TH1, out of range fills count as entries but not in the stats
+        double *hist_stats = &stats[hist * N_STATS];
+        hist_stats[ENTRIES] += 1;
+        if (bin == 0 || bin > n_bins) {
+            return;
+        }
+        hist_stats[SUMW] += 1;
+        hist_stats[SUMW2] += 1;
+        hist_stats[SUMWX] += value;
+        hist_stats[SUMWX2] += value * value;
+    }
+    // fill(hists[i], values[i]) for i < n
+    void fill(const int *hist_ids, const double *values, int n) {
+        for (int i = 0; i < n; i++) {
+            fill(hist_ids[i], values[i]);
+        }
+    }
+    // fill(i, values[i]) for every histogram
+    void fill_each(const double *values) {
+        for (int i = 0; i < hists; i++) {
+            fill(i, values[i]);
+        }
+    }
+
+    // Fill every histogram with `value` until it has n_entries entries.  For
+    // the zero suppressed fills: only the hits of an event are filled, and
+    // padding with n_events zeros before the histograms are used gives the
+    // same contents and statistics as filling every event.
+    void pad(Long64_t n_entries, double value);
+
+    void add(const HistogramBank1D &other);
+    void reset();
+
+    void write(const std::string &name) const;
+    bool add_from(TDirectory *dir, const std::string &name);
+
+    // A new TH1D with the contents and statistics of histogram `hist`, not
+    // attached to any directory
+    TH1D *to_th1(int hist, const char *name, const char *title) const;
+
+private:
+    enum { ENTRIES, SUMW, SUMW2, SUMWX, SUMWX2, N_STATS };
+
+    // Same arithmetic as TAxis::FindBin for fixed bins
+    int find_bin(double value) const {
+        if (value < low) {
+            return 0;
+        }
+        if (!(value < high)) {
+            return n_bins + 1;
+        }
+        return 1 + int(n_bins * (value - low) / (high - low));
+    }
+
+    int hists;
+    int n_bins;
+    double low;
+    double high;
+    int stride;
+    std::vector<double> counts;
+    std::vector<double> stats;
+};
+
+class HistogramBank2D {
+public:
+    HistogramBank2D(int n_hists, int n_bins_x, double low_x, double high_x, int n_bins_y, double low_y, double high_y);
+
+    int n_hists() const { return hists; }
+
+    void fill(int hist, double x, double y) {
+        int bin_x = find_bin(x, n_bins_x, low_x, high_x);
+        int bin_y = find_bin(y, n_bins_y, low_y, high_y);
+        counts[hist * stride + bin_y * (n_bins_x + 2) + bin_x] += 1;
+        double *hist_stats = &stats[hist * N_STATS];
+        hist_stats[ENTRIES] += 1;
+        if (bin_x == 0 || bin_x > n_bins_x || bin_y == 0 || bin_y > n_bins_y) {
+            return;
+        }
+        hist_stats[SUMW] += 1;
+        hist_stats[SUMW2] += 1;
+        hist_stats[SUMWX] += x;
+        hist_stats[SUMWX2] += x * x;
+        hist_stats[SUMWY] += y;
+        hist_stats[SUMWY2] += y * y;
+        hist_stats[SUMWXY] += x * y;
+    }
+    void fill(const int *hist_ids, const double *x, const double *y, int n) {
+        for (int i = 0; i < n; i++) {
+            fill(hist_ids[i], x[i], y[i]);
+        }
+    }
+
+    void add(const HistogramBank2D &other);
+    void reset();
+
+    void write(const std::string &name) const;
+    bool add_from(TDirectory *dir, const std::string &name);
+
+    TH2F *to_th2(int hist, const char *name, const char *title) const;
+
+private:
+    enum { ENTRIES, SUMW, SUMW2, SUMWX, SUMWX2, SUMWY, SUMWY2, SUMWXY, N_STATS };
+
+    static int find_bin(double value, int n_bins, double low, double high) {
+        if (value < low) {
+            return 0;
+        }
+        if (!(value < high)) {
+            return n_bins + 1;
+        }
+        return 1 + int(n_bins * (value - low) / (high - low));
+    }
+
+    int hists;
+    int n_bins_x, n_bins_y;
+    double low_x, high_x, low_y, high_y;
+    int stride;
+    std::vector<float> counts;   // float like TH2F
+    std::vector<double> stats;
+};
@@ -0,0 +1,14 @@
+#include "eeemcal_hits.h"
+
+void find_hits(const WaveformFeatures &features, HitList &hits) {
+    int n = 0;
+    for (int i = 0; i < features.n_channels; i++) {
+        bool hit = features.max_adc[i] > HIT_NOISE_SIGMAS * features.noise[i] || features.max_tot[i] > 0;
+        if (!hit) {
+            continue;
+        }
+        hits.hits[n++] = {i, features.max_adc[i], features.max_tot[i], features.max_sample[i],
+                          features.toa_sample[i], features.n_tot[i], features.n_toa[i]};
+    }
+    hits.n_hits = n;
+}
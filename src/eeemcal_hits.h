@@ -0,0 +1,41 @@
+#pragma once
+
+#include "eeemcal_features.h"
+#include "eeemcal_mapping.h"
+
+// Zero suppressed view of the features of one event.  A mapped channel is a
+// hit if its max ADC is above HIT_NOISE_SIGMAS times the noise of its
+// pedestal, or if it has a ToT at all.  In beam events only a handful of
+// the 400 channels are hits, so the sums, correlations and clusters loop
+// over those and leave the rest as zero.
+//
+// The TOA is not part of the threshold: it is only read by the loops that
+// ask for its branch, and the hits must be the same with and without it.
+// It is carried as an attribute of the hits, and the loops that count TOAs
+// on their own take them from the features.
+
+// Max ADC threshold in units of the pedestal noise of the channel
+const float HIT_NOISE_SIGMAS = 4;
+
+struct Hit {
+    int index;          // mapped channel, crystal * n_sipms + sipm
+    float amplitude;    // max ADC above the pedestal
+    int tot;            // max ToT
+    int max_sample;     // sample of the max ADC
+    int toa_sample;     // first sample with a TOA, -1 if none
+    int n_tot;          // samples with ToT > 0
+    int n_toa;          // samples with TOA > 0
+};
+
+// The hits of one event, in mapped channel order, in a buffer with room for
+// every mapped channel.  A list is made once per chunk or loop and refilled
+// for each event, so building it never allocates.
+struct HitList {
+    int n_hits = 0;
+    Hit hits[MAX_MAPPED_CHANNELS];
+
+    const Hit *begin() const { return hits; }
+    const Hit *end() const { return hits + n_hits; }
+};
+
+void find_hits(const WaveformFeatures &features, HitList &hits);
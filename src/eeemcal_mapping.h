@@ -0,0 +1,166 @@
+#pragma once
+
+// Single source of the EEEMCal channel mapping.  Everything in here is
+// constexpr, so the ROOT macros can include this header without loading the
+// library, and the flat lookup tables below are built and checked at compile
+// time.
+
+const int NUM_CHANNELS = 576;   // 4 FPGAs x 2 ASICs x 72 channels
+const int NUM_SAMPLES = 20;
+const int NUM_CRYSTALS = 25;
+const int MAX_SIPMS_PER_CRYSTAL = 16;
+const int MAX_MAPPED_CHANNELS = NUM_CRYSTALS * MAX_SIPMS_PER_CRYSTAL;
+
+// Mode | Readout
+// 0    | 16i
+// 1    | 4x4
+// 2    | 16p
+const int READOUT_16I = 0;
+const int READOUT_4X4 = 1;
+const int READOUT_16P = 2;
+const int NUM_READOUT_MODES = 3;
+
+constexpr int sipms_per_crystal[NUM_READOUT_MODES] = {16, 4, 1};
+
+// EEEMCal mapping - instead of "layers", we have a single plane, where each crystal is one connector
+// FPGA IP | ID
+// 208     | 0
+// 209     | 1
+// 210     | 2
+// 211     | 3
+constexpr int eeemcal_fpga_map[NUM_CRYSTALS] = {0, 3, 3, 0, 3,
+                                                2, 1, 1, 1, 2,
+                                                2, 1, 1, 1, 3,
+                                                2, 2, 1, 2, 3,
+                                                2, 0, 0, 1, 2};
+
+// ASIC | ID
+// 0    | 0
+// 1    | 1
+constexpr int eeemcal_asic_map[NUM_CRYSTALS] = { 1, 1, 1, 0, 0,
+                                                 1, 1, 1, 1, 1,
+                                                 1, 0, 0, 0, 0,
+                                                 1, 0, 1, 0, 0,
+                                                 0, 1, 1, 0, 0};
+
+// Connector | ID
+// A        | 0
+// B        | 1
+// C        | 2
+// D        | 3
+constexpr int eeemcal_connector_map[NUM_CRYSTALS] = { 2,  0,  1,  0,  1,
+                                                      0,  2,  0,  3,  3,
+                                                      1,  2,  0,  3,  0,
+                                                      2,  0,  1,  1,  2,
+                                                      3,  1,  3,  1,  2};
+
+// Channel within the ASIC for each SiPM of a connector
+constexpr int eeemcal_16i_channel_map[4][16] = {
+    { 2,  6, 11, 15,  0,  4,  9, 13,  1,  5, 10, 14,  3,  7, 12, 16},   // A
+    {20, 24, 29, 33, 18, 22, 27, 31, 19, 23, 28, 32, 21, 25, 30, 34},   // B
+    {67, 63, 59, 55, 69, 65, 61, 57, 70, 66, 60, 56, 68, 64, 58, 54},   // C
+    {50, 46, 40, 36, 52, 48, 42, 38, 51, 47, 43, 39, 49, 45, 41, 37}};  // D
+
+constexpr int eeemcal_4x4_channel_map[4][4] = {
+    { 0,  4,  9, 12},   // A
+    {20, 24, 27, 31},   // B
+    {58, 62, 65, 69},   // C
+    {38, 42, 48, 52}};  // D
+
+constexpr int eeemcal_16p_channel_map[4] = {6, 26, 63, 46};
+
+// Crystal number as labelled on the prototype, in the order of the 5x5 pads
+constexpr int crystal_ID[NUM_CRYSTALS] = {5, 10, 15, 20, 25,
+                                          4, 9, 14, 19, 24,
+                                          3, 8, 13, 18, 23,
+                                          2, 7, 12, 17, 22,
+                                          1, 6, 11, 16, 21};
+
+constexpr int connector_channel(int readout, int connector, int sipm) {
+    return readout == READOUT_16I ? eeemcal_16i_channel_map[connector][sipm]
+         : readout == READOUT_4X4 ? eeemcal_4x4_channel_map[connector][sipm]
+         : eeemcal_16p_channel_map[connector];
+}
+
+// Flat lookup tables for one readout mode.  A mapped channel is addressed by
+// its index crystal * n_sipms + sipm, which is also how the per-SiPM
+// histograms are laid out.
+struct ChannelMap {
+    int readout = 0;
+    int n_sipms = 0;
+    int n_mapped = 0;
+    int channel[MAX_MAPPED_CHANNELS] = {};      // index -> electronics channel
+    int index[NUM_CHANNELS] = {};               // electronics channel -> index, -1 if not mapped
+
+    constexpr int crystal_of(int mapped_index) const { return mapped_index / n_sipms; }
+    constexpr int sipm_of(int mapped_index) const { return mapped_index % n_sipms; }
+    constexpr int channel_of(int crystal, int sipm) const { return channel[crystal * n_sipms + sipm]; }
+};
+
+constexpr ChannelMap make_channel_map(int readout) {
+    ChannelMap map;
+    map.readout = readout;
+    map.n_sipms = sipms_per_crystal[readout];
+    map.n_mapped = NUM_CRYSTALS * map.n_sipms;
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+        map.index[channel] = -1;
+    }
+    for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+        for (int sipm = 0; sipm < map.n_sipms; sipm++) {
+            int channel = 144 * eeemcal_fpga_map[crystal] + 72 * eeemcal_asic_map[crystal]
+                        + connector_channel(readout, eeemcal_connector_map[crystal], sipm);
+            int mapped_index = crystal * map.n_sipms + sipm;
+            map.channel[mapped_index] = channel;
+            if (channel >= 0 && channel < NUM_CHANNELS) {
+                map.index[channel] = mapped_index;
+            }
+        }
+    }
+    return map;
+}
+
+constexpr ChannelMap eeemcal_channel_maps[NUM_READOUT_MODES] = {make_channel_map(READOUT_16I),
+                                                                make_channel_map(READOUT_4X4),
+                                                                make_channel_map(READOUT_16P)};
+
+// Compile time consistency checks of the tables above
+constexpr bool crystal_addresses_valid() {
+    for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+        if (eeemcal_fpga_map[crystal] < 0 || eeemcal_fpga_map[crystal] > 3) return false;
+        if (eeemcal_asic_map[crystal] < 0 || eeemcal_asic_map[crystal] > 1) return false;
+        if (eeemcal_connector_map[crystal] < 0 || eeemcal_connector_map[crystal] > 3) return false;
+    }
+    return true;
+}
+
+constexpr bool connector_channels_valid(int readout) {
+    for (int connector = 0; connector < 4; connector++) {
+        for (int sipm = 0; sipm < sipms_per_crystal[readout]; sipm++) {
+            int channel = connector_channel(readout, connector, sipm);
+            if (channel < 0 || channel >= 72) return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool channel_map_valid(const ChannelMap &map) {
+    for (int i = 0; i < map.n_mapped; i++) {
+        int channel = map.channel[i];
+        if (channel < 0 || channel >= NUM_CHANNELS) return false;
+        // a duplicate channel leaves the inverse pointing at the later index
+        if (map.index[channel] != i) return false;
+    }
+    int n_inverse = 0;
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+        if (map.index[channel] >= 0) n_inverse++;
+    }
+    return n_inverse == map.n_mapped;
+}
+
+static_assert(crystal_addresses_valid(), "FPGA, ASIC or connector out of range in the crystal map");
+static_assert(connector_channels_valid(READOUT_16I), "16i connector channel out of range");
+static_assert(connector_channels_valid(READOUT_4X4), "4x4 connector channel out of range");
+static_assert(connector_channels_valid(READOUT_16P), "16p connector channel out of range");
+static_assert(channel_map_valid(eeemcal_channel_maps[READOUT_16I]), "duplicate channel in the 16i map");
+static_assert(channel_map_valid(eeemcal_channel_maps[READOUT_4X4]), "duplicate channel in the 4x4 map");
+static_assert(channel_map_valid(eeemcal_channel_maps[READOUT_16P]), "duplicate channel in the 16p map");
@@ -0,0 +1,91 @@
+#include "eeemcal_pedestal.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Mean absolute deviation of the median of 3 gaussian samples -> sigma of
+// one sample, 1.87, corrected for the cap below
+static const float MEDIAN_MAD_TO_SIGMA = 2.0f;
+// Largest contribution of one event to the noise, in units of the noise
+static const float NOISE_CAP = 2;
+
+static float median3(float a, float b, float c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+PedestalTracker::PedestalTracker() {
+    reset();
+}
+
+void PedestalTracker::reset() {
+    std::fill(estimates.pedestal, estimates.pedestal + NUM_CHANNELS, 0.0f);
+    std::fill(estimates.noise, estimates.noise + NUM_CHANNELS, 0.0f);
+    events = 0;
+    next_entry = -1;
+}
+
+bool PedestalTracker::start_block(EventReader &reader, Long64_t entry, const ChannelMap &channel_map) {
+    Long64_t first = entry - entry % PEDESTAL_BLOCK_ENTRIES;
+    Long64_t warmup_last = std::min(first + PEDESTAL_WARMUP, reader.n_entries());
+    reset();
+    for (Long64_t i = first; i < warmup_last; i++) {
+        if (!reader.get_adc(i)) {
+            return false;
+        }
+        update(reader.adc(), channel_map);
+    }
+    // The warm-up only settles the estimates, the block is followed from
+    // its first entry
+    for (Long64_t i = first; i < entry; i++) {
+        if (!reader.get_adc(i)) {
+            return false;
+        }
+        update(reader.adc(), channel_map);
+    }
+    return true;
+}
+
+int PedestalTracker::read(EventReader &reader, Long64_t entry, const ChannelMap &channel_map) {
+    if (entry != next_entry || entry % PEDESTAL_BLOCK_ENTRIES == 0) {
+        if (!start_block(reader, entry, channel_map)) {
+            next_entry = -1;
+            return 0;
+        }
+    }
+    int bytes = reader.get_entry(entry);
+    if (!bytes) {
+        next_entry = -1;
+        return 0;
+    }
+    update(reader.adc(), channel_map);
+    next_entry = entry + 1;
+    return bytes;
+}
+
+Long64_t pedestal_ready_entries(Long64_t n_entries) {
+    Long64_t in_last_block = n_entries % PEDESTAL_BLOCK_ENTRIES;
+    return in_last_block < PEDESTAL_WARMUP ? n_entries - in_last_block : n_entries;
+}
+
+void PedestalTracker::update(const uint adc[NUM_CHANNELS][NUM_SAMPLES], const ChannelMap &channel_map) {
+    static_assert(PEDESTAL_SAMPLES == 3, "the pedestal uses the median of 3 samples");
+    // The first event starts low and quiet, the pulses are positive
+    bool first = events == 0;
+    float weight = std::max(1.0f / (events + 1), PEDESTAL_WEIGHT);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        int channel = channel_map.channel[i];
+        const uint *samples = adc[channel];
+        float s0 = samples[0], s1 = samples[1], s2 = samples[2];
+        float median = median3(s0, s1, s2);
+        float pedestal = first ? std::min(std::min(s0, s1), s2) : estimates.pedestal[channel];
+        float noise = first ? std::min(std::min(std::fabs(s0 - s1), std::fabs(s1 - s2)), std::fabs(s0 - s2)) : estimates.noise[channel];
+        float limit = PEDESTAL_CLIP * noise;
+        float deviation = median - pedestal;
+        estimates.pedestal[channel] = pedestal + weight * std::min(std::max(deviation, -limit), limit);
+        // Capped, so a pulse moves the noise no more than a 2 sigma
+        // fluctuation does, while a pedestal that is off still opens it up
+        float spread = std::min(MEDIAN_MAD_TO_SIGMA * std::fabs(deviation), NOISE_CAP * noise);
+        estimates.noise[channel] = std::max(noise + weight * (spread - noise), PEDESTAL_MIN_NOISE);
+    }
+    events++;
+}
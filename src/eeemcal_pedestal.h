@@ -0,0 +1,89 @@
+#pragma once
+
+#include "eeemcal_mapping.h"
+#include "eeemcal_reader.h"
+
+#include <RtypesCore.h>
+
+#include <sys/types.h>
+
+// Streaming per channel pedestal and noise, replacing the subtraction of
+// sample 0.  Every event moves each estimate by a bounded step towards the
+// median of the pre-trigger samples, so a single noisy sample or a pulse
+// that starts early barely moves it:
+//
+//   deviation = clamp(median - pedestal, +-PEDESTAL_CLIP * noise)
+//   pedestal += weight * deviation
+//
+// The noise follows the mean absolute deviation of the median, each event
+// capped at twice the noise, scaled to the sigma of one gaussian sample.
+// The clamp is narrow, so the pedestal follows the median of the events
+// rather than their mean and holds as long as fewer than about a third of
+// them have a pulse in the pre-trigger samples.  The first event starts
+// from its lowest pre-trigger sample, the weight is 1/n for the next ones
+// and PEDESTAL_WEIGHT once that is smaller.  The update is O(1) per channel
+// and event and the tracker has a fixed size for all 576 channels.
+//
+// The pedestals of an event only depend on its block of the run, entries
+// [k * PEDESTAL_BLOCK_ENTRIES, (k + 1) * PEDESTAL_BLOCK_ENTRIES): the tracker
+// restarts at the start of every block, is warmed up on the first
+// PEDESTAL_WARMUP events of the block and then follows the block from its
+// start.  So the threaded chunks, the serial loops and the online mode,
+// which all split the run differently, subtract the same pedestals from
+// every event, and no event is seen by a cold tracker.
+
+// Samples before the earliest pulses
+const int PEDESTAL_SAMPLES = 3;
+// Weight of one event once the tracker is warm, ~ 1 / the events averaged
+const float PEDESTAL_WEIGHT = 1.0f / 256;
+// Largest step of one event, in units of the noise
+const float PEDESTAL_CLIP = 0.5f;
+// Floor of the noise, so the clamp never closes
+const float PEDESTAL_MIN_NOISE = 0.5f;
+// Entries of a block, and events of the warm-up at its start, one time
+// constant of the tracker
+const Long64_t PEDESTAL_BLOCK_ENTRIES = 4096;
+const int PEDESTAL_WARMUP = 256;
+
+// Per electronics channel pedestal and noise (ADC), zero for the channels
+// the tracker has not seen
+struct PedestalSnapshot {
+    alignas(64) float pedestal[NUM_CHANNELS];
+    alignas(64) float noise[NUM_CHANNELS];
+};
+
+// Pedestals of the events an event loop reads, in increasing entry order.
+// A tracker belongs to the thread of its loop, like the reader it reads
+// from; the snapshot is valid until the next read.
+class PedestalTracker {
+public:
+    PedestalTracker();
+    PedestalTracker(const PedestalTracker &) = delete;
+    PedestalTracker &operator=(const PedestalTracker &) = delete;
+
+    // Read `entry` and add it to the pedestals.  At the start of a block, or
+    // if the previous read was not entry - 1, the tracker first restarts
+    // with the warm-up of the block and catches up to the entry, reading
+    // only the ADC.  Returns the bytes read, 0 on error, like
+    // EventReader::get_entry.
+    int read(EventReader &reader, Long64_t entry, const ChannelMap &channel_map);
+
+    // Add the pre-trigger samples of the mapped channels of one event
+    void update(const uint adc[NUM_CHANNELS][NUM_SAMPLES], const ChannelMap &channel_map);
+    void reset();
+
+    const PedestalSnapshot &snapshot() const { return estimates; }
+    Long64_t n_events() const { return events; }
+
+private:
+    bool start_block(EventReader &reader, Long64_t entry, const ChannelMap &channel_map);
+
+    PedestalSnapshot estimates;
+    Long64_t events = 0;
+    Long64_t next_entry = -1;
+};
+
+// Of the first n_entries of a run that is still being written, the entries
+// whose pedestals are final: all but a last block that does not have its
+// warm-up events yet
+Long64_t pedestal_ready_entries(Long64_t n_entries);
@@ -0,0 +1,80 @@
+#include "eeemcal_reader.h"
+
+#include <TBranch.h>
+
+#include <iostream>
+
+static const Long64_t TREE_CACHE_SIZE = 64 * 1024 * 1024;
+
+EventReader::EventReader(TTree *tree, int branches) : tree(tree), branches(branches) {
+    const int flags[3] = {BRANCH_ADC, BRANCH_TOT, BRANCH_TOA};
+    const char *names[3] = {"adc", "tot", "toa"};
+    std::vector<uint> *buffers[3] = {&adc_buffer, &tot_buffer, &toa_buffer};
+
+    tree->SetBranchStatus("*", false);
+    tree->SetCacheSize(TREE_CACHE_SIZE);
+    for (int i = 0; i < 3; i++) {
+        if (!(branches & flags[i])) {
+            continue;
+        }
+        TBranch *branch = tree->GetBranch(names[i]);
+        if (!branch) {
+            std::cerr << "Error getting branch " << names[i] << " from tree" << std::endl;
+            valid = false;
+            continue;
+        }
+        buffers[i]->resize(NUM_CHANNELS * NUM_SAMPLES);
+        tree->SetBranchStatus(names[i], true);
+        tree->SetBranchAddress(names[i], buffers[i]->data());
+        tree->AddBranchToCache(names[i], true);
+        active_branches.push_back(branch);
+        if (flags[i] == BRANCH_ADC) {
+            adc_branch = branch;
+        }
+    }
+    tree->StopCacheLearningPhase();
+}
+
+void EventReader::set_entry_range(Long64_t first, Long64_t last) {
+    tree->SetCacheEntryRange(first, last);
+}
+
+void EventReader::set_random_access() {
+    tree->SetCacheSize(0);
+}
+
+int EventReader::get_entry(Long64_t entry) {
+    if (tree->LoadTree(entry) < 0) {
+        return 0;
+    }
+    int bytes = 0;
+    for (auto branch : active_branches) {
+        int branch_bytes = branch->GetEntry(entry);
+        if (branch_bytes <= 0) {
+            return 0;
+        }
+        bytes += branch_bytes;
+    }
+    total_bytes += bytes;
+    return bytes;
+}
+
+int EventReader::get_adc(Long64_t entry) {
+    if (!adc_branch || tree->LoadTree(entry) < 0) {
+        return 0;
+    }
+    int bytes = adc_branch->GetEntry(entry);
+    if (bytes <= 0) {
+        return 0;
+    }
+    total_bytes += bytes;
+    return bytes;
+}
+
+uint (*EventReader::buffer(int branch))[NUM_SAMPLES] {
+    std::vector<uint> &storage = branch == BRANCH_ADC ? adc_buffer : branch == BRANCH_TOT ? tot_buffer : toa_buffer;
+    if (storage.empty()) {
+        return nullptr;
+    }
+    return reinterpret_cast<uint (*)[NUM_SAMPLES]>(storage.data());
+}
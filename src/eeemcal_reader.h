@@ -0,0 +1,56 @@
+#pragma once
+
+#include "eeemcal_mapping.h"
+
+#include <TTree.h>
+
+#include <sys/types.h>
+#include <vector>
+
+// Branches of the `events` tree an analysis can ask for
+const int BRANCH_ADC = 1 << 0;
+const int BRANCH_TOT = 1 << 1;
+const int BRANCH_TOA = 1 << 2;
+
+// Reads only the branches an analysis declares.  All other branches of the
+// tree are disabled, the tree cache only prefetches the requested ones, and
+// GetEntry is done per branch so nothing else is decompressed.
+//
+// The decoder stores each quantity as a single 576x20 leaf, so ROOT always
+// unpacks a requested branch as a whole; restricting the work to the mapped
+// channels happens in extract_features, which only gathers those.
+class EventReader {
+public:
+    EventReader(TTree *tree, int branches);
+
+    bool is_valid() const { return valid; }
+    Long64_t n_entries() const { return tree->GetEntries(); }
+    // Restrict the tree cache to the entries that will be read
+    void set_entry_range(Long64_t first, Long64_t last);
+    // For a few scattered entries: no tree cache, so only the baskets of
+    // the entries read are read
+    void set_random_access();
+    // Returns the number of uncompressed bytes read, 0 on error
+    int get_entry(Long64_t entry);
+    // Only the ADC branch, for the pedestal warm-up
+    int get_adc(Long64_t entry);
+    Long64_t bytes_read() const { return total_bytes; }
+
+    // Null if the branch was not requested
+    uint (*adc())[NUM_SAMPLES] { return buffer(BRANCH_ADC); }
+    uint (*tot())[NUM_SAMPLES] { return buffer(BRANCH_TOT); }
+    uint (*toa())[NUM_SAMPLES] { return buffer(BRANCH_TOA); }
+
+private:
+    uint (*buffer(int branch))[NUM_SAMPLES];
+
+    TTree *tree;
+    int branches;
+    bool valid = true;
+    Long64_t total_bytes = 0;
+    std::vector<TBranch*> active_branches;
+    TBranch *adc_branch = nullptr;
+    std::vector<uint> adc_buffer;
+    std::vector<uint> tot_buffer;
+    std::vector<uint> toa_buffer;
+};
@@ -0,0 +1,175 @@
+#include "eeemcal_render.h"
+#include "eeemcal_event_loop.h"
+
+#include <TString.h>
+#include <TSystem.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+const char *const RENDER_USAGE =
+    "  --no-plots  only write the fit results, draw the PDFs later with render_plots\n"
+    "  --render-workers N  processes drawing the PDFs, 0 (default) for one per core\n";
+
+RenderOptions &render_options() {
+    static RenderOptions options;
+    return options;
+}
+
+bool parse_render_option(int argc, char **argv, int &i) {
+    if (strcmp(argv[i], "--no-plots") == 0) {
+        render_options().plots = false;
+    } else if (strcmp(argv[i], "--render-workers") == 0 && i + 1 < argc) {
+        render_options().workers = std::atoi(argv[++i]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void save_page(TCanvas *canvas, const std::string &pdf, int page, int first, int last) {
+    if (last - first == 1) {
+        canvas->SaveAs(pdf.c_str());
+    } else if (page == first) {
+        canvas->SaveAs((pdf + "(").c_str());
+    } else if (page == last - 1) {
+        canvas->SaveAs((pdf + ")").c_str());
+    } else {
+        canvas->SaveAs(pdf.c_str());
+    }
+}
+
+void render_plots(const std::vector<RenderJob> &jobs) {
+    if (render_options().plots) {
+        render_documents(jobs, render_options().workers);
+    }
+}
+
+static const char *find_stitch_tool() {
+    if (std::system("command -v pdfunite > /dev/null 2>&1") == 0) {
+        return "pdfunite";
+    }
+    if (std::system("command -v qpdf > /dev/null 2>&1") == 0) {
+        return "qpdf";
+    }
+    return nullptr;
+}
+
+// Page range of a document drawn by one worker
+struct RenderPart {
+    int job;
+    int first;
+    int last;
+    std::string pdf;
+};
+
+static bool stitch(const char *tool, const std::string &pdf, const std::vector<std::string> &parts) {
+    std::string command = tool;
+    if (strcmp(tool, "qpdf") == 0) {
+        command += " --empty --pages";
+    }
+    for (const std::string &part : parts) {
+        command += " '" + part + "'";
+    }
+    if (strcmp(tool, "qpdf") == 0) {
+        command += " --";
+    }
+    command += " '" + pdf + "'";
+    return std::system(command.c_str()) == 0;
+}
+
+bool render_documents(const std::vector<RenderJob> &jobs, int n_workers) {
+    int n_pages = 0;
+    for (const RenderJob &job : jobs) {
+        n_pages += job.n_pages;
+    }
+    n_workers = std::min(resolve_thread_count(n_workers), std::max(n_pages, 1));
+    bool only_images = std::all_of(jobs.begin(), jobs.end(), [](const RenderJob &job) { return job.images; });
+    const char *tool = n_workers <= 1 ? nullptr : only_images ? "" : find_stitch_tool();
+    if (!tool) {
+        bool ok = true;
+        for (const RenderJob &job : jobs) {
+            ok = job.render(0, job.n_pages, job.pdf) && ok;
+        }
+        return ok;
+    }
+
+    // Split the documents into about n_workers equal page ranges, each
+    // within one document
+    int pages_per_part = (n_pages + n_workers - 1) / n_workers;
+    std::vector<RenderPart> parts;
+    for (int job = 0; job < (int)jobs.size(); job++) {
+        const std::string &pdf = jobs[job].pdf;
+        std::string stem = pdf.substr(0, pdf.size() - 4);
+        for (int first = 0; first < jobs[job].n_pages; first += pages_per_part) {
+            int last = std::min(first + pages_per_part, jobs[job].n_pages);
+            parts.push_back({job, first, last, stem + Form(".part%02d.pdf", (int)parts.size())});
+        }
+    }
+
+    // Each part on a forked worker, n_workers at a time.  The fits are done
+    // and their threads joined, so the workers start from a quiet process.
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(nullptr);
+    bool ok = true;
+    int running = 0;
+    auto wait_one = [&]() {
+        int status = 0;
+        if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ok = false;
+        }
+        running--;
+    };
+    for (const RenderPart &part : parts) {
+        if (running == n_workers) {
+            wait_one();
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool part_ok = jobs[part.job].render(part.first, part.last, part.pdf);
+            fflush(nullptr);
+            _exit(part_ok ? 0 : 1);
+        } else if (pid < 0) {
+            std::cerr << "Error starting a render worker, drawing " << part.pdf << " here" << std::endl;
+            ok = jobs[part.job].render(part.first, part.last, part.pdf) && ok;
+        } else {
+            running++;
+        }
+    }
+    while (running > 0) {
+        wait_one();
+    }
+    if (!ok) {
+        std::cerr << "Error rendering the plots" << std::endl;
+    }
+
+    for (int job = 0; job < (int)jobs.size(); job++) {
+        if (jobs[job].images) {
+            continue;
+        }
+        std::vector<std::string> job_parts;
+        for (const RenderPart &part : parts) {
+            if (part.job == job) {
+                job_parts.push_back(part.pdf);
+            }
+        }
+        // After a failed worker the parts are only removed
+        if (ok && job_parts.size() == 1) {
+            ok = gSystem->Rename(job_parts[0].c_str(), jobs[job].pdf.c_str()) == 0;
+        } else if (ok && !stitch(tool, jobs[job].pdf, job_parts)) {
+            std::cerr << "Error joining the pages of " << jobs[job].pdf << " with " << tool << std::endl;
+            ok = false;
+        }
+        for (const std::string &part : job_parts) {
+            gSystem->Unlink(part.c_str());
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <TCanvas.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Deferred rendering of the plots.  The analyses write their fit results
+// and histograms to output/<name>_<analysis>_results.root and the PDFs are
+// drawn from there, either right after the fits or later by render_plots.
+//
+// A document is split into page ranges that are drawn by forked worker
+// processes, each into a PDF of its own, which are then joined with
+// pdfunite (or qpdf).  Without either tool, or with one worker, the pages
+// are drawn in the calling process straight into the document.
+struct RenderJob {
+    std::string pdf;    // the document, "output/Run056_adc_single_sum.pdf"
+    int n_pages;
+    // Draw pages [first, last) of the document into pdf
+    std::function<bool(int first, int last, const std::string &pdf)> render;
+    // The pages are separate images that render names itself, so the
+    // workers' outputs are not joined and pdf is unused
+    bool images = false;
+};
+
+// Draw the documents with up to n_workers processes, 0 for one per core
+bool render_documents(const std::vector<RenderJob> &jobs, int n_workers);
+
+// Save page `page` of the range [first, last) of a multi-page PDF, opening
+// it on the first page and closing it on the last
+void save_page(TCanvas *canvas, const std::string &pdf, int page, int first, int last);
+
+// Whether the analyses draw their plots once the fits are done, and with how
+// many worker processes.  Set once by the executables, before any analysis
+// runs; --no-plots only writes the results files.
+struct RenderOptions {
+    bool plots = true;
+    int workers = 0;
+};
+RenderOptions &render_options();
+
+// Render the documents of the analysis if plots are enabled
+void render_plots(const std::vector<RenderJob> &jobs);
+
+// Command line options of the executables for the plots: --no-plots and
+// --render-workers N.  Returns true if argv[i] is one of them, advancing i
+// past its value.
+bool parse_render_option(int argc, char **argv, int &i);
+extern const char *const RENDER_USAGE;
@@ -0,0 +1,87 @@
+#include "eeemcal_run_catalog.h"
+
+#include <sqlite3.h>
+
+#include <iostream>
+#include <string>
+
+static const char *const RUN_COLUMNS =
+    "SELECT run, COALESCE(beam_energy, 0), COALESCE(position_x, 0), COALESCE(position_y, 0), good FROM runs";
+
+static sqlite3 *open_catalog() {
+    sqlite3 *db = nullptr;
+    if (sqlite3_open_v2(RUN_CATALOG_PATH, &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open the run catalog " << RUN_CATALOG_PATH << ", run `python run_catalog.py sync`" << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    return db;
+}
+
+static sqlite3_stmt *prepare(sqlite3 *db, const std::string &sql) {
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
+        std::cerr << "Run catalog query failed: " << sqlite3_errmsg(db) << std::endl;
+        return nullptr;
+    }
+    return statement;
+}
+
+static RunInfo read_run(sqlite3_stmt *statement) {
+    RunInfo info;
+    info.run = sqlite3_column_int(statement, 0);
+    info.beam_energy = sqlite3_column_double(statement, 1);
+    info.position_x = sqlite3_column_double(statement, 2);
+    info.position_y = sqlite3_column_double(statement, 3);
+    info.good = sqlite3_column_int(statement, 4) != 0;
+    return info;
+}
+
+bool find_run(int run_number, RunInfo &info) {
+    sqlite3 *db = open_catalog();
+    if (!db) {
+        return false;
+    }
+    bool found = false;
+    sqlite3_stmt *statement = prepare(db, std::string(RUN_COLUMNS) + " WHERE run = ?");
+    if (statement) {
+        sqlite3_bind_int(statement, 1, run_number);
+        if (sqlite3_step(statement) == SQLITE_ROW) {
+            info = read_run(statement);
+            found = true;
+        }
+        sqlite3_finalize(statement);
+    }
+    sqlite3_close(db);
+    return found;
+}
+
+std::vector<RunInfo> select_runs(const RunQuery &query) {
+    std::vector<RunInfo> runs;
+    sqlite3 *db = open_catalog();
+    if (!db) {
+        return runs;
+    }
+    std::string sql = std::string(RUN_COLUMNS) + " WHERE run BETWEEN ? AND ?";
+    if (query.good_only) {
+        sql += " AND good = 1";
+    }
+    if (query.beam_energy > 0) {
+        sql += " AND beam_energy BETWEEN ? AND ?";
+    }
+    sqlite3_stmt *statement = prepare(db, sql + " ORDER BY run");
+    if (statement) {
+        sqlite3_bind_int(statement, 1, query.first_run);
+        sqlite3_bind_int(statement, 2, query.last_run);
+        if (query.beam_energy > 0) {
+            sqlite3_bind_double(statement, 3, query.beam_energy - 1e-6);
+            sqlite3_bind_double(statement, 4, query.beam_energy + 1e-6);
+        }
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            runs.push_back(read_run(statement));
+        }
+        sqlite3_finalize(statement);
+    }
+    sqlite3_close(db);
+    return runs;
+}
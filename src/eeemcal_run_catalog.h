@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+// Read access to the local run catalog, the SQLite copy of the run log that
+// run_catalog.py keeps in output/run_catalog.sqlite.  The catalog is only
+// read here; `python run_catalog.py sync` updates it.
+#define RUN_CATALOG_PATH "output/run_catalog.sqlite"
+
+struct RunInfo {
+    int run = -1;
+    double beam_energy = 0;     // GeV, 0 if not in the run log
+    double position_x = 0;      // mm
+    double position_y = 0;      // mm
+    bool good = false;
+};
+
+struct RunQuery {
+    int first_run = 0;
+    int last_run = 1 << 30;
+    double beam_energy = 0;     // <= 0 for any energy
+    bool good_only = false;
+};
+
+// Returns false if the catalog cannot be opened or does not have the run
+bool find_run(int run_number, RunInfo &info);
+
+// Matching runs in run order, empty if the catalog cannot be opened
+std::vector<RunInfo> select_runs(const RunQuery &query);
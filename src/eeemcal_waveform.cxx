@@ -0,0 +1,26 @@
+#include "eeemcal_waveform.h"
+
+// Calibrated amplitude of mapped channel `index`: the gain matched max ADC
+// below the ToT threshold, the ToT converted amplitude above it
+double get_full_waveform_sum(const WaveformFeatures &features, int index, int channel, const Calibration &calibration) {
+    double value = features.max_adc[index];
+    double gain = calibration.gain[channel];
+    // Check if the max value is under the ToT threshold
+    if (value < 700) {
+        return value * gain;
+    }
+
+    // If it's above, we switch to using the ToT conversion
+    double tot_value = features.max_tot[index];
+    if (tot_value < 200 || !calibration.tot_valid(channel)) {
+        return 0;
+    }
+    double slope = calibration.tot_slope[channel];
+    double intercept = calibration.tot_intercept[channel];
+
+    // ToT = (adc * slope) + intercept
+    // (ToT - intercept) / slope = adc
+    value = (tot_value - intercept) / slope;
+    value *= gain;
+    return value;
+}
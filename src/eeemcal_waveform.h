@@ -0,0 +1,9 @@
+#pragma once
+
+#include "eeemcal_calibration.h"
+#include "eeemcal_features.h"
+#include "eeemcal_mapping.h"
+
+#include <sys/types.h>
+
+double get_full_waveform_sum(const WaveformFeatures &features, int index, int channel, const Calibration &calibration);
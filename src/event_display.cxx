@@ -0,0 +1,368 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_mapping.h"
+#include "eeemcal_reader.h"
+#include "eeemcal_render.h"
+
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TCanvas.h>
+#include <TPad.h>
+#include <TGraph.h>
+#include <TError.h>
+#include <TStyle.h>
+#include <TColor.h>
+#include <TLatex.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Events shown by event_display and event_display_tot
+static const int DISPLAY_EVENTS = 10;
+// Background colours of the SiPM pads, by max signal
+static const int BACKGROUND_LEVELS = 64;
+
+// What the ADC and ToT displays differ in
+struct DisplayStyle {
+    const char *label;      // title
+    const char *file_label; // output name
+    const char *y_title;
+    double max_signal;
+};
+
+static DisplayStyle display_style(int branch) {
+    if (branch == BRANCH_TOT) {
+        return {"TOT", "tot", "TOT Counts", 4096};
+    }
+    return {"ADC", "adc", "ADC Counts", 1024};
+}
+
+// One canvas with the pads and graphs of every SiPM, built once and redrawn
+// for each event by changing the points, titles and pad colours, so drawing
+// more events does not take more memory.
+//
+// Mode | Readout | SiPM pads per crystal
+// 0    | 16i     | 4x4
+// 1    | 4x4     | 2x2
+// 2    | 16p     | 1
+class EventDisplayCanvas {
+public:
+    EventDisplayCanvas(int run, int branch, int mode);
+    void draw(Long64_t event, const uint (*waveform)[NUM_SAMPLES]);
+    TCanvas *canvas() { return canvas_.get(); }
+
+private:
+    int run;
+    DisplayStyle style;
+    const ChannelMap &channel_map;
+    std::unique_ptr<TCanvas> canvas_;
+    TLatex *title;
+    std::vector<TGraph*> graphs;          // by mapped index
+    std::vector<TVirtualPad*> pads;       // by mapped index
+    std::vector<int> background_colors;   // by level
+};
+
+EventDisplayCanvas::EventDisplayCanvas(int run, int branch, int mode)
+    : run(run), style(display_style(branch)), channel_map(eeemcal_channel_maps[mode]) {
+    gStyle->SetOptStat(0);
+    canvas_.reset(new TCanvas(Form("event_display_%s", style.file_label), "c", 1600, 1200));
+    canvas_->cd(0);
+    title = new TLatex(0.05, 0.9, "");
+    title->SetNDC();
+    title->SetTextSize(0.05);
+    title->Draw();
+    auto pad = new TPad("pad", "pad", 0.05, 0.05, 0.95, 0.85);
+    pad->Draw();
+    pad->cd();
+    pad->Divide(5, 5, 0.001, 0.001);
+
+    // Green for half scale, towards red above and blue below
+    double half = style.max_signal / 2;
+    for (int level = 0; level <= BACKGROUND_LEVELS; level++) {
+        double max_signal = style.max_signal * level / BACKGROUND_LEVELS;
+        int red = (int)(255 * max_signal / style.max_signal);
+        int green = (int)(255 * (1 - std::abs(max_signal - half) / half));
+        int blue = (int)(255 * (1 - max_signal / style.max_signal));
+        background_colors.push_back(TColor::GetColorTransparent(TColor::GetColor(red, green, blue), 0.2));
+    }
+
+    int pads_per_side = std::lround(std::sqrt(channel_map.n_sipms));
+    for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+        TVirtualPad *crystal_pad = pad->cd(crystal+1);
+        if (channel_map.n_sipms > 1) {
+            crystal_pad->Divide(pads_per_side, pads_per_side, 0, 0);
+        }
+        for (int sipm = 0; sipm < channel_map.n_sipms; sipm++) {
+            TVirtualPad *sipm_pad = channel_map.n_sipms > 1 ? crystal_pad->cd(sipm+1) : crystal_pad;
+            TGraph *g = new TGraph(NUM_SAMPLES);
+            g->GetXaxis()->SetTitle("Sample");
+            g->GetYaxis()->SetTitle(style.y_title);
+            g->GetXaxis()->SetRange(0, NUM_SAMPLES-1);
+            g->SetMarkerStyle(20);
+            g->SetMarkerSize(0.5);
+            for (int sample = 0; sample < NUM_SAMPLES; sample++) {
+                g->SetPoint(sample, sample + 0.5, 0);
+            }
+            g->SetMinimum(0);
+            g->SetMaximum(style.max_signal);
+            g->Draw("APL");
+            graphs.push_back(g);
+            pads.push_back(sipm_pad);
+        }
+        // Draw borders between 4x4 groups
+        if (crystal % 5 == 4) {
+            gPad->SetFrameLineWidth(2);
+            gPad->SetFrameLineColor(kBlack);
+        }
+    }
+}
+
+void EventDisplayCanvas::draw(Long64_t event, const uint (*waveform)[NUM_SAMPLES]) {
+    title->SetTitle(Form("%s: Run %d, Event %lld", style.label, run, event));
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        int channel_number = channel_map.channel[i];
+        TGraph *g = graphs[i];
+        g->SetTitle(Form("crystal_%d_sipm_%d_event_%lld_ch_%d", channel_map.crystal_of(i), channel_map.sipm_of(i), event, channel_number));
+        double max_signal = 0;
+        for (int sample = 0; sample < NUM_SAMPLES; sample++) {
+            double signal = waveform[channel_number][sample];
+            g->SetPoint(sample, sample + 0.5, signal);
+            if (signal > max_signal) {
+                max_signal = signal;
+            }
+        }
+        // Set background color based on max signal
+        int level = (int)(BACKGROUND_LEVELS * std::min(max_signal / style.max_signal, 1.0));
+        pads[i]->SetFillColor(background_colors[level]);
+        pads[i]->Modified();
+    }
+    canvas_->Modified();
+    canvas_->Update();
+}
+
+static std::string display_name(int run, int branch) {
+    return Form("output/Run%03d_event_display_%s", run, display_style(branch).file_label);
+}
+
+static std::string event_image_path(int run, int branch, Long64_t event) {
+    return display_name(run, branch) + Form("_%06lld.png", event);
+}
+
+// The waveforms of one event, NUM_CHANNELS x NUM_SAMPLES
+using Waveform = const uint (*)[NUM_SAMPLES];
+
+// Draw the events [first, last) of the list, each as a page of pdf or as an
+// image of its own.  get_waveform returns the waveforms of an event.
+static bool draw_events(int run, const EventDisplayOptions &options, int first, int last, const std::string &pdf,
+                        const std::function<Waveform(Long64_t)> &get_waveform) {
+    EventDisplayCanvas display(run, options.branch, options.mode);
+    for (int i = first; i < last; i++) {
+        Long64_t event = options.events[i];
+        auto waveform = get_waveform(event);
+        if (!waveform) {
+            std::cerr << "Error reading event " << event << std::endl;
+            return false;
+        }
+        display.draw(event, waveform);
+        if (options.images) {
+            display.canvas()->SaveAs(event_image_path(run, options.branch, event).c_str());
+        } else {
+            save_page(display.canvas(), pdf, i, first, last);
+        }
+    }
+    return true;
+}
+
+static RenderJob display_job(int run, const EventDisplayOptions &options,
+                             const std::function<bool(int, int, const std::string &)> &render) {
+    RenderJob job;
+    job.pdf = display_name(run, options.branch) + ".pdf";
+    job.n_pages = options.events.size();
+    job.render = render;
+    job.images = options.images;
+    return job;
+}
+
+bool display_events(int run, EventDisplayOptions options, int n_workers) {
+    gErrorIgnoreLevel = kWarning;
+    auto path = getenv("OUTPUT_PATH");
+    std::string file_name = Form("%s/Run%03d.root", path, run);
+    Long64_t n_events = 0;
+    {
+        std::unique_ptr<TFile> file(TFile::Open(file_name.c_str()));
+        TTree *tree = nullptr;
+        if (file && !file->IsZombie()) {
+            file->GetObject("events", tree);
+        }
+        if (!tree) {
+            std::cerr << "Error getting tree from " << file_name << std::endl;
+            return false;
+        }
+        n_events = tree->GetEntries();
+    }
+
+    // Events in run order, without the ones past the end
+    std::sort(options.events.begin(), options.events.end());
+    options.events.erase(std::unique(options.events.begin(), options.events.end()), options.events.end());
+    auto past_end = std::lower_bound(options.events.begin(), options.events.end(), n_events);
+    if (past_end != options.events.end()) {
+        std::cerr << "Run has " << n_events << " events, skipping the events from " << *past_end << std::endl;
+        options.events.erase(past_end, options.events.end());
+    }
+    options.events.erase(options.events.begin(), std::lower_bound(options.events.begin(), options.events.end(), 0));
+    if (options.events.empty()) {
+        return false;
+    }
+
+    // Each worker reads only its own events, and only the displayed branch
+    RenderJob job = display_job(run, options, [=](int first, int last, const std::string &pdf) {
+        std::unique_ptr<TFile> file(TFile::Open(file_name.c_str()));
+        TTree *tree = nullptr;
+        if (file && !file->IsZombie()) {
+            file->GetObject("events", tree);
+        }
+        if (!tree) {
+            std::cerr << "Error getting tree from " << file_name << std::endl;
+            return false;
+        }
+        EventReader reader(tree, options.branch);
+        if (!reader.is_valid()) {
+            return false;
+        }
+        // Runs of events through the cache, events picked from the index
+        // one by one
+        Long64_t span = options.events[last-1] + 1 - options.events[first];
+        if (span <= 4 * (last - first)) {
+            reader.set_entry_range(options.events[first], options.events[last-1] + 1);
+        } else {
+            reader.set_random_access();
+        }
+        return draw_events(run, options, first, last, pdf, [&](Long64_t event) -> Waveform {
+            if (!reader.get_entry(event)) {
+                return nullptr;
+            }
+            return options.branch == BRANCH_TOT ? reader.tot() : reader.adc();
+        });
+    });
+    return render_documents({job}, n_workers);
+}
+
+bool parse_event_list(const std::string &text, std::vector<Long64_t> &events) {
+    std::stringstream ranges(text);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        char *end = nullptr;
+        Long64_t first = std::strtoll(range.c_str(), &end, 10);
+        Long64_t last = first;
+        if (*end == '-') {
+            last = std::strtoll(end + 1, &end, 10);
+        }
+        if (end == range.c_str() || *end != '\0' || first < 0 || last < first) {
+            std::cerr << "Bad event range " << range << std::endl;
+            return false;
+        }
+        for (Long64_t event = first; event <= last; event++) {
+            events.push_back(event);
+        }
+    }
+    return !events.empty();
+}
+
+static void display_run(int run, int event, int mode, int branch) {
+    if (event < 0) {
+        std::cerr << "No event given" << std::endl;
+        return;
+    }
+    EventDisplayOptions options;
+    options.branch = branch;
+    options.mode = mode;
+    for (int i = 0; i < DISPLAY_EVENTS; i++) {
+        options.events.push_back(event + i);
+    }
+    display_events(run, options, render_options().workers);
+}
+
+void event_display(int run, int event, int mode) {
+    display_run(run, event, mode, BRANCH_ADC);
+}
+
+void event_display_tot(int run, int event, int mode) {
+    display_run(run, event, mode, BRANCH_TOT);
+}
+
+// Module of the fused driver: keeps the waveforms of the listed events as
+// they stream past and draws them at the end
+class EventDisplayModule : public AnalysisModule {
+public:
+    EventDisplayModule(int run, const EventDisplayOptions &options)
+        : run(run), options(options) {
+        std::sort(this->options.events.begin(), this->options.events.end());
+        this->options.events.erase(std::unique(this->options.events.begin(), this->options.events.end()), this->options.events.end());
+    }
+
+    const char *name() const override { return options.branch == BRANCH_TOT ? "event_display_tot" : "event_display"; }
+    int branches() const override { return options.branch; }
+
+    std::unique_ptr<ModuleState> make_state(int) const override {
+        return std::unique_ptr<ModuleState>(new State(*this));
+    }
+    void merge(ModuleState &state) override {
+        auto &chunk_events = static_cast<State &>(state).events;
+        for (auto &event : chunk_events) {
+            events.push_back(std::move(event));
+        }
+    }
+    void finish() override {
+        // The events the run has, in the order they were merged, which is run order
+        EventDisplayOptions shown = options;
+        shown.events.clear();
+        for (auto &event : events) {
+            shown.events.push_back(event.first);
+        }
+        if (shown.events.empty()) {
+            std::cerr << "Run has none of the displayed events" << std::endl;
+            return;
+        }
+        RenderJob job = display_job(run, shown, [&](int first, int last, const std::string &pdf) {
+            return draw_events(run, shown, first, last, pdf, [&](Long64_t event) -> Waveform {
+                auto found = std::lower_bound(events.begin(), events.end(), event,
+                    [](const DisplayEvent &shown_event, Long64_t entry) { return shown_event.first < entry; });
+                return reinterpret_cast<Waveform>(found->second.data());
+            });
+        });
+        render_documents({job}, render_options().workers);
+    }
+
+private:
+    using DisplayEvent = std::pair<Long64_t, std::vector<uint>>;   // entry, NUM_CHANNELS x NUM_SAMPLES
+
+    struct State : public ModuleState {
+        const EventDisplayModule &module;
+        std::vector<DisplayEvent> events;
+
+        State(const EventDisplayModule &module) : module(module) {}
+        void process(Long64_t entry, EventReader &reader, const WaveformFeatures &, const HitList &) override {
+            if (!std::binary_search(module.options.events.begin(), module.options.events.end(), entry)) {
+                return;
+            }
+            const uint (*waveform)[NUM_SAMPLES] = module.options.branch == BRANCH_TOT ? reader.tot() : reader.adc();
+            events.emplace_back(entry, std::vector<uint>(&waveform[0][0], &waveform[0][0] + NUM_CHANNELS * NUM_SAMPLES));
+        }
+    };
+
+    int run;
+    EventDisplayOptions options;
+    std::vector<DisplayEvent> events;
+};
+
+std::unique_ptr<AnalysisModule> make_event_display_module(int run, const EventDisplayOptions &options) {
+    return std::unique_ptr<AnalysisModule>(new EventDisplayModule(run, options));
+}
@@ -0,0 +1,46 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_event_index.h"
+#include "eeemcal_mapping.h"
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Keys of every event of the run, written to event_index_path(run).  The
+// TOA branch is read for the multi-hit flag.
+class EventIndexModule : public AnalysisModule {
+public:
+    EventIndexModule(int run) : run(run) {}
+
+    const char *name() const override { return "event_index"; }
+    int branches() const override { return BRANCH_ADC | BRANCH_TOT | BRANCH_TOA; }
+
+    std::unique_ptr<ModuleState> make_state(int) const override {
+        return std::unique_ptr<ModuleState>(new State);
+    }
+    void merge(ModuleState &state) override {
+        auto &chunk_keys = static_cast<State &>(state).keys;
+        keys.insert(keys.end(), chunk_keys.begin(), chunk_keys.end());
+    }
+    void finish() override {
+        if (write_event_index(run, keys)) {
+            std::cout << "Indexed " << keys.size() << " events in " << event_index_path(run) << std::endl;
+        }
+    }
+
+private:
+    struct State : public ModuleState {
+        std::vector<EventKey> keys;
+
+        void process(Long64_t entry, EventReader &, const WaveformFeatures &features, const HitList &hits) override {
+            keys.push_back(make_event_key(entry, features, hits, eeemcal_channel_maps[READOUT_16I]));
+        }
+    };
+
+    int run;
+    std::vector<EventKey> keys;
+};
+
+std::unique_ptr<AnalysisModule> make_event_index_module(int run) {
+    return std::unique_ptr<AnalysisModule>(new EventIndexModule(run));
+}
@@ -0,0 +1,72 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_cluster.h"
+#include "eeemcal_histogram_bank.h"
+#include "eeemcal_mapping.h"
+
+#include <TFile.h>
+#include <TF1.h>
+#include <TH1D.h>
+#include <TString.h>
+
+#include <iostream>
+#include <memory>
+
+std::string position_summary_path(int run) {
+    return Form("output/Run%03d_position_summary.root", run);
+}
+
+// Sum of the max ADC of the SiPMs of the center crystal, per event, with a
+// gaussian fit of its peak.  The position scan compares these between runs
+// with the beam at different positions.
+class PositionSummaryModule : public AnalysisModule {
+public:
+    PositionSummaryModule(int run) : run(run), center_sum(1, 500, 0, 8000) {}
+
+    const char *name() const override { return "position_summary"; }
+    int branches() const override { return BRANCH_ADC; }
+
+    std::unique_ptr<ModuleState> make_state(int) const override {
+        return std::unique_ptr<ModuleState>(new State);
+    }
+    void merge(ModuleState &state) override {
+        center_sum.add(static_cast<State &>(state).center_sum);
+    }
+    void finish() override {
+        std::unique_ptr<TH1D> hist(center_sum.to_th1(0, "center_adc_sum", "ADC Sum;ADC;Counts"));
+        TF1 fit("fit", "gaus", 3500, 5000, TF1::EAddToList::kNo);
+        hist->Fit(&fit, "QR");
+        std::string path = position_summary_path(run);
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error writing " << path << std::endl;
+            return;
+        }
+        hist->Write();
+        file->Close();
+    }
+
+private:
+    struct State : public ModuleState {
+        HistogramBank1D center_sum{1, 500, 0, 8000};
+
+        void process(Long64_t, EventReader &, const WaveformFeatures &, const HitList &hits) override {
+            const ChannelMap &channel_map = eeemcal_channel_maps[READOUT_16I];
+            int adc_sum = 0;
+            for (const Hit &hit : hits) {
+                if (channel_map.crystal_of(hit.index) == CENTER_CRYSTAL) {
+                    adc_sum += hit.amplitude;
+                }
+            }
+            if (adc_sum > 0) {
+                center_sum.fill(0, adc_sum);
+            }
+        }
+    };
+
+    int run;
+    HistogramBank1D center_sum;
+};
+
+std::unique_ptr<AnalysisModule> make_position_summary_module(int run) {
+    return std::unique_ptr<AnalysisModule>(new PositionSummaryModule(run));
+}
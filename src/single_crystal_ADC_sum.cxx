@@ -0,0 +1,926 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_calibration.h"
+#include "eeemcal_cluster.h"
+#include "eeemcal_crystal_ball.h"
+#include "eeemcal_event_loop.h"
+#include "eeemcal_feature_cache.h"
+#include "eeemcal_features.h"
+#include "eeemcal_fit.h"
+#include "eeemcal_fit_seeds.h"
+#include "eeemcal_follow.h"
+#include "eeemcal_histogram_bank.h"
+#include "eeemcal_hits.h"
+#include "eeemcal_mapping.h"
+#include "eeemcal_reader.h"
+#include "eeemcal_render.h"
+#include "eeemcal_waveform.h"
+
+#include <TROOT.h>
+#include <TH1.h>
+#include <TH1D.h>
+#include <TH1F.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TCanvas.h>
+#include <TPad.h>
+#include <TLatex.h>
+#include <TStyle.h>
+#include <TF1.h>
+#include <TLine.h>
+#include <TNamed.h>
+#include <TParameter.h>
+#include <TSystem.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Entries per chunk of the threaded event loop, rounded up to whole clusters
+static const Long64_t CHUNK_ENTRIES = 20000;
+// Mean single SiPM ADC the gain factors match every channel to
+static const double GAIN_TARGET = 400;
+
+// Everything the event loop fills.  Each chunk of the run fills its own set,
+// and the sets are merged in chunk order.
+struct AdcSumHistograms {
+    enum { CENTER_CALO, FULL_CALO };
+
+    HistogramBank1D sipm_single_sums;     // per mapped channel
+    HistogramBank1D sipm_full_sums;
+    HistogramBank1D crystal_single_sums;  // per crystal
+    HistogramBank1D crystal_full_sums;
+    HistogramBank1D calo_single_sums;     // CENTER_CALO, FULL_CALO
+    HistogramBank1D calo_full_sums;
+    Long64_t n_events = 0;
+
+    AdcSumHistograms(int readout);
+    // Only the hits are filled into the SiPM and crystal banks, pad adds
+    // the zeros of the others; call it before the banks are used
+    void fill(const WaveformFeatures &features, const HitList &hits, const ChannelMap &channel_map, const Calibration &calibration);
+    void pad();
+    void add(const AdcSumHistograms &other);
+    // The banks and counters in an accumulator file
+    void write() const;
+    bool add_from(TDirectory *dir);
+};
+
+AdcSumHistograms::AdcSumHistograms(int readout)
+    : sipm_single_sums(25 * sipms_per_crystal[readout], 256, 150, 1024),
+      sipm_full_sums(25 * sipms_per_crystal[readout], 256, 150, 2200),
+      crystal_single_sums(25, 256 * sipms_per_crystal[readout], 0, 1024 * sipms_per_crystal[readout]),
+      crystal_full_sums(25, 25 * sipms_per_crystal[readout], 0, 2500 * sipms_per_crystal[readout]),
+      calo_single_sums(2, 256 * sipms_per_crystal[readout], 0, 1024 * sipms_per_crystal[readout]),
+      calo_full_sums(2, 25 * sipms_per_crystal[readout], 0, 4000 * sipms_per_crystal[readout]) {}
+
+void AdcSumHistograms::fill(const WaveformFeatures &features, const HitList &hits, const ChannelMap &channel_map, const Calibration &calibration) {
+    int crystal_single[25] = {};
+    int crystal_full[25] = {};
+    int center_single_sum = 0;
+    int event_single_sum = 0;
+    double center_full_sum = 0;
+    double event_full_sum = 0;
+    for (const Hit &hit : hits) {
+        int index = hit.index;
+        int crystal = channel_map.crystal_of(index);
+        int crystal_channel = channel_map.channel[index];
+        // A channel without a valid gain keeps its raw amplitude (gain 1)
+        double single_adc = hit.amplitude;
+        if (calibration.gain_valid(crystal_channel)) {
+            single_adc *= calibration.gain[crystal_channel];
+        }
+        single_adc = round(single_adc);
+        double full_adc = 0;
+        // The full waveform sum needs both constants, skip the channel otherwise
+        if (calibration.gain_valid(crystal_channel) && calibration.tot_valid(crystal_channel)) {
+            full_adc = get_full_waveform_sum(features, index, crystal_channel, calibration);
+        }
+        crystal_single[crystal] += single_adc;
+        crystal_full[crystal] += full_adc;
+        if (is_center_crystal(crystal)) {
+            center_single_sum += single_adc;
+            center_full_sum += full_adc;
+        }
+        event_single_sum += single_adc;
+        event_full_sum += full_adc;
+        if (single_adc != 0) {
+            sipm_single_sums.fill(index, single_adc);
+        }
+        if (full_adc != 0) {
+            sipm_full_sums.fill(index, full_adc);
+        }
+    }
+    for (int crystal = 0; crystal < 25; crystal++) {
+        if (crystal_single[crystal] != 0) {
+            crystal_single_sums.fill(crystal, crystal_single[crystal]);
+        }
+        if (crystal_full[crystal] != 0) {
+            crystal_full_sums.fill(crystal, crystal_full[crystal]);
+        }
+    }
+    calo_single_sums.fill(CENTER_CALO, center_single_sum);
+    calo_full_sums.fill(CENTER_CALO, center_full_sum);
+    // std::cout << center_full_sum << std::endl;
+    calo_single_sums.fill(FULL_CALO, event_single_sum);
+    calo_full_sums.fill(FULL_CALO, event_full_sum);
+    // std::cout << event_full_sum << std::endl;
+    n_events++;
+}
+
+void AdcSumHistograms::pad() {
+    sipm_single_sums.pad(n_events, 0);
+    sipm_full_sums.pad(n_events, 0);
+    crystal_single_sums.pad(n_events, 0);
+    crystal_full_sums.pad(n_events, 0);
+}
+
+void AdcSumHistograms::add(const AdcSumHistograms &other) {
+    sipm_single_sums.add(other.sipm_single_sums);
+    sipm_full_sums.add(other.sipm_full_sums);
+    crystal_single_sums.add(other.crystal_single_sums);
+    crystal_full_sums.add(other.crystal_full_sums);
+    calo_single_sums.add(other.calo_single_sums);
+    calo_full_sums.add(other.calo_full_sums);
+    n_events += other.n_events;
+}
+
+void AdcSumHistograms::write() const {
+    sipm_single_sums.write("sipm_single_sums");
+    sipm_full_sums.write("sipm_full_sums");
+    crystal_single_sums.write("crystal_single_sums");
+    crystal_full_sums.write("crystal_full_sums");
+    calo_single_sums.write("calo_single_sums");
+    calo_full_sums.write("calo_full_sums");
+    TParameter<Long64_t>("n_events", n_events).Write();
+}
+
+bool AdcSumHistograms::add_from(TDirectory *dir) {
+    TParameter<Long64_t> *events = nullptr;
+    dir->GetObject("n_events", events);
+    if (!events) {
+        std::cerr << "Error getting n_events from " << dir->GetName() << std::endl;
+        return false;
+    }
+    n_events += events->GetVal();
+    delete events;
+    return sipm_single_sums.add_from(dir, "sipm_single_sums") &&
+           sipm_full_sums.add_from(dir, "sipm_full_sums") &&
+           crystal_single_sums.add_from(dir, "crystal_single_sums") &&
+           crystal_full_sums.add_from(dir, "crystal_full_sums") &&
+           calo_single_sums.add_from(dir, "calo_single_sums") &&
+           calo_full_sums.add_from(dir, "calo_full_sums");
+}
+
+// ROOT histograms of a set of totals, for the fits, plots and online files
+struct AdcSumSpectra {
+    std::vector<TH1D*> sipm_single_sums;
+    std::vector<TH1D*> sipm_full_sums;
+    std::vector<TH1D*> crystal_single_sums;
+    std::vector<TH1D*> crystal_full_sums;
+    TH1D *center_calo_single_sum;
+    TH1D *center_calo_full_sum;
+    TH1D *full_calo_single_sum;
+    TH1D *full_calo_full_sum;
+
+    std::vector<TObject*> all() const;
+};
+
+// Names of the spectra, in the online and results files
+static std::string sipm_sum_name(int crystal, int sipm, const char *kind) {
+    return Form("crystal_%02d_sipm_%02d_sum_%s", crystal, sipm, kind);
+}
+
+static std::string crystal_sum_name(int crystal, const char *kind) {
+    return Form("crystal_%02d_sum_%s", crystal, kind);
+}
+
+static AdcSumSpectra make_spectra(const AdcSumHistograms &totals, int readout) {
+    AdcSumSpectra spectra;
+    for (int crystal = 0; crystal < 25; crystal++) {
+        for (int sipm = 0; sipm < sipms_per_crystal[readout]; sipm++) {
+            int index = crystal * sipms_per_crystal[readout] + sipm;
+            spectra.sipm_single_sums.push_back(totals.sipm_single_sums.to_th1(index, sipm_sum_name(crystal, sipm, "single").c_str(), Form("Crystal %d SiPM %d Max ADC Sum;ADC;Counts", crystal, sipm)));
+            spectra.sipm_full_sums.push_back(totals.sipm_full_sums.to_th1(index, sipm_sum_name(crystal, sipm, "full").c_str(), Form("Crystal %d SiPM %d ADC Sum;ADC;Counts", crystal, sipm)));
+        }
+    }
+    for (int crystal = 0; crystal < 25; crystal++) {
+        spectra.crystal_single_sums.push_back(totals.crystal_single_sums.to_th1(crystal, crystal_sum_name(crystal, "single").c_str(), Form("Crystal %d ADC Sum;ADC;Counts", crystal)));
+        spectra.crystal_full_sums.push_back(totals.crystal_full_sums.to_th1(crystal, crystal_sum_name(crystal, "full").c_str(), Form("Crystal %d ADC Sum;ADC;Counts", crystal)));
+    }
+    spectra.center_calo_single_sum = totals.calo_single_sums.to_th1(AdcSumHistograms::CENTER_CALO, "center_calo_single_sum_single", "Center Calorimeter ADC Sum;ADC;Counts");
+    spectra.center_calo_full_sum = totals.calo_full_sums.to_th1(AdcSumHistograms::CENTER_CALO, "center_calo_full_sum_single", "Center Calorimeter ADC Sum;ADC;Counts");
+    spectra.full_calo_single_sum = totals.calo_single_sums.to_th1(AdcSumHistograms::FULL_CALO, "full_calo_single_sum_single", "Full Calorimeter ADC Sum;ADC;Counts");
+    spectra.full_calo_full_sum = totals.calo_full_sums.to_th1(AdcSumHistograms::FULL_CALO, "full_calo_full_sum_single", "Full Calorimeter ADC Sum;ADC;Counts");
+    return spectra;
+}
+
+// The spectra of a results file, with their fits attached.  They stay owned
+// by the file.
+static bool load_spectra(TDirectory *dir, int readout, AdcSumSpectra &spectra) {
+    bool ok = true;
+    auto get = [&](const std::string &name) {
+        TH1D *hist = nullptr;
+        dir->GetObject(name.c_str(), hist);
+        if (!hist) {
+            std::cerr << "Error getting " << name << " from " << dir->GetName() << std::endl;
+            ok = false;
+        }
+        return hist;
+    };
+    for (int crystal = 0; crystal < 25; crystal++) {
+        for (int sipm = 0; sipm < sipms_per_crystal[readout]; sipm++) {
+            spectra.sipm_single_sums.push_back(get(sipm_sum_name(crystal, sipm, "single")));
+            spectra.sipm_full_sums.push_back(get(sipm_sum_name(crystal, sipm, "full")));
+        }
+    }
+    for (int crystal = 0; crystal < 25; crystal++) {
+        spectra.crystal_single_sums.push_back(get(crystal_sum_name(crystal, "single")));
+        spectra.crystal_full_sums.push_back(get(crystal_sum_name(crystal, "full")));
+    }
+    spectra.center_calo_single_sum = get("center_calo_single_sum_single");
+    spectra.center_calo_full_sum = get("center_calo_full_sum_single");
+    spectra.full_calo_single_sum = get("full_calo_single_sum_single");
+    spectra.full_calo_full_sum = get("full_calo_full_sum_single");
+    return ok;
+}
+
+std::vector<TObject*> AdcSumSpectra::all() const {
+    std::vector<TObject*> objects;
+    objects.insert(objects.end(), sipm_single_sums.begin(), sipm_single_sums.end());
+    objects.insert(objects.end(), sipm_full_sums.begin(), sipm_full_sums.end());
+    objects.insert(objects.end(), crystal_single_sums.begin(), crystal_single_sums.end());
+    objects.insert(objects.end(), crystal_full_sums.begin(), crystal_full_sums.end());
+    objects.insert(objects.end(), {center_calo_single_sum, center_calo_full_sum, full_calo_single_sum, full_calo_full_sum});
+    return objects;
+}
+
+// Crystal ball fit of a peak over [lower_range, upper_range], starting from
+// the seed of `key` if there is one and from x_bar and sigma otherwise.  The
+// x_bar and sigma limits are only set if given.
+static FitTask peak_fit(const FitSeeds &seeds, const std::string &key, TH1 *hist, double lower_range, double upper_range,
+                        double x_bar, double sigma,
+                        double x_bar_min = 0, double x_bar_max = 0, double sigma_min = 0, double sigma_max = 0) {
+    FitTask task;
+    task.hist = hist;
+    task.make_function = [=, &seeds](const char *name) {
+        TF1 *fit = create_fit_function(name, lower_range, upper_range);
+        fit->SetParameter(2, x_bar);
+        if (x_bar_min < x_bar_max) {
+            fit->SetParLimits(2, x_bar_min, x_bar_max);
+        }
+        fit->SetParameter(3, sigma);
+        if (sigma_min < sigma_max) {
+            fit->SetParLimits(3, sigma_min, sigma_max);
+        }
+        seeds.apply(key, fit);
+        return fit;
+    };
+    task.fitter = fit_crystal_ball;
+    return task;
+}
+
+// Accumulator file of a run or of merged runs, see merge_adc_sum_runs
+static bool write_adc_sum_accumulators(const AdcSumHistograms &totals, int readout, const OutputName &output, double beam_energy) {
+    std::string path = accumulator_path(output.file, "adc_sum");
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+    totals.write();
+    TParameter<int>("readout", readout).Write();
+    TParameter<double>("beam_energy", beam_energy).Write();
+    file->Close();
+    return true;
+}
+
+// Fit results of a run or of merged runs, the input of the plots
+static std::string adc_sum_results_path(const std::string &output_file) {
+    return results_path(output_file, "adc_sum");
+}
+
+// Fits and gain factors of the merged totals of a run.  The spectra with
+// their fits go to the results file, from which the plots are drawn.
+// Returns false if the accumulator or results file cannot be written.
+static bool fit_adc_sums(AdcSumHistograms &totals, int readout, const OutputName &output, int n_threads, double beam_energy) {
+    const ChannelMap &channel_map = eeemcal_channel_maps[readout];
+    totals.pad();
+    bool ok = write_adc_sum_accumulators(totals, readout, output, beam_energy);
+
+    // Only the merged totals become ROOT histograms, for the fits and plots
+    AdcSumSpectra spectra = make_spectra(totals, readout);
+    std::vector<TH1D*> &sipm_single_sums = spectra.sipm_single_sums;
+    std::vector<TH1D*> &sipm_full_sums = spectra.sipm_full_sums;
+    std::vector<TH1D*> &crystal_single_sums = spectra.crystal_single_sums;
+    std::vector<TH1D*> &crystal_full_sums = spectra.crystal_full_sums;
+
+    int lower_range = 200 * sipms_per_crystal[readout];
+    int upper_range = 900 * sipms_per_crystal[readout];
+    int full_lower_range = 1150 * sipms_per_crystal[readout];
+    int full_upper_range = 1800 * sipms_per_crystal[readout];
+
+    // The fits are all independent, so run them up front on the worker threads
+    FitSeeds seeds(beam_energy);
+    seeds.load(output.run);
+    std::vector<std::string> fit_keys;
+    std::vector<FitTask> fit_tasks;
+    auto add_peak_fit = [&](const std::string &key, TH1 *hist, double lower, double upper, double x_bar, double sigma,
+                            double x_bar_min = 0, double x_bar_max = 0, double sigma_min = 0, double sigma_max = 0) {
+        fit_keys.push_back(key);
+        fit_tasks.push_back(peak_fit(seeds, key, hist, lower, upper, x_bar, sigma, x_bar_min, x_bar_max, sigma_min, sigma_max));
+    };
+    for (int crystal = 0; crystal < 25; crystal++) {
+        add_peak_fit(Form("crystal_single_%02d", crystal), crystal_single_sums[crystal], lower_range, upper_range, 5000, 1000);
+    }
+    add_peak_fit("center_single", spectra.center_calo_single_sum, 6000, 12000, 10000, 1000);
+    add_peak_fit("full_single", spectra.full_calo_single_sum, 10000, 16000, 14000, 2000);
+    size_t sipm_single_fits = fit_tasks.size();
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        add_peak_fit(Form("sipm_single_%03d", i), sipm_single_sums[i], 175, 900, 250, 100);
+    }
+    for (int crystal = 0; crystal < 25; crystal++) {
+        add_peak_fit(Form("crystal_full_%02d", crystal), crystal_full_sums[crystal], full_lower_range, full_upper_range, 25000, 1000, 10000, 35000, 100, 2000);
+    }
+    add_peak_fit("center_full", spectra.center_calo_full_sum, 26500, 38000, 30000, 1000, 20000, 40000, 100, 2000);
+    add_peak_fit("full_full", spectra.full_calo_full_sum, 30000, 45000, 40000, 2000, 31000, 50000, 1000, 3000);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        add_peak_fit(Form("sipm_full_%03d", i), sipm_full_sums[i], 1000, 2000, 250, 100);
+    }
+    std::vector<FitResult> fits = run_fits(fit_tasks, n_threads);
+    for (size_t task = 0; task < fits.size(); task++) {
+        if (fits[task].status == 0) {
+            seeds.record(fit_keys[task], fits[task].function);
+        }
+    }
+    // Seeds come from single runs only
+    if (output.run >= 0) {
+        seeds.save(output.run);
+    }
+
+    // Track the mean value per channel, mapped channel i in bin i + 1 like
+    // the online summary
+    auto mean_ADC = new TH1D("mean_ADC", "Mean ADC;Channel;Mean ADC", channel_map.n_mapped, 0, channel_map.n_mapped);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        auto fit = fits[sipm_single_fits + i].function;
+        mean_ADC->SetBinContent(i + 1, fit->GetParameter(2));
+        mean_ADC->SetBinError(i + 1, fit->GetParError(2));
+    }
+
+    // Calculate gain factors for each channel
+    double target = GAIN_TARGET;
+    TH1F *gain_factors = new TH1F("gain_factors", "Gain Factors;Channel;Gain Factor", 576, 0, 576);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        int crystal_channel = channel_map.channel[i];
+        
+        double mean = mean_ADC->GetBinContent(i + 1);
+        double correction = 1;
+        if (mean > 1) {
+            correction = target/mean;
+        }
+        gain_factors->SetBinContent(crystal_channel + FIRST_CHANNEL_BIN, correction);
+        std::cout << crystal_channel << " " << mean << " " << correction << std::endl;
+        gain_factors->SetBinError(crystal_channel + FIRST_CHANNEL_BIN, 0);//mean_ADC->GetBinError(i)/mean * correction);
+    }
+
+    // Write the corrections histogram
+    TFile *corrections_file = new TFile(Form("output/%s_corrections.root.new", output.file.c_str()), "RECREATE");
+    gain_factors->Write();
+    TParameter<int>("first_channel_bin", FIRST_CHANNEL_BIN).Write();
+    corrections_file->Close();
+
+    // Write the results for the plots
+    std::string path = adc_sum_results_path(output.file);
+    std::unique_ptr<TFile> results_file(TFile::Open(path.c_str(), "RECREATE"));
+    if (!results_file || results_file->IsZombie()) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+    for (auto object : spectra.all()) {
+        object->Write();
+    }
+    mean_ADC->Write();
+    gain_factors->Write();
+    TParameter<int>("readout", readout).Write();
+    TNamed("title", output.title.c_str()).Write();
+    results_file->Close();
+
+    render_plots(adc_sum_render_jobs(output.file));
+    return ok;
+}
+
+// What the plots need from a results file
+struct AdcSumResults {
+    int readout;
+    std::string title;
+    AdcSumSpectra spectra;
+    TH1D *mean_ADC = nullptr;
+    TH1F *gain_factors = nullptr;
+};
+
+static bool load_adc_sum_results(TDirectory *dir, AdcSumResults &results) {
+    TParameter<int> *readout = nullptr;
+    TNamed *title = nullptr;
+    dir->GetObject("readout", readout);
+    dir->GetObject("title", title);
+    dir->GetObject("mean_ADC", results.mean_ADC);
+    dir->GetObject("gain_factors", results.gain_factors);
+    if (!readout || !title || !results.mean_ADC || !results.gain_factors) {
+        std::cerr << dir->GetName() << " is not an ADC sum results file" << std::endl;
+        return false;
+    }
+    results.readout = readout->GetVal();
+    results.title = title->GetTitle();
+    return load_spectra(dir, results.readout, results.spectra);
+}
+
+// Pages of the single and full ADC sum documents
+enum {
+    PAGE_CRYSTAL_SUMS,
+    PAGE_CENTER_SUM,
+    PAGE_FULL_CALO_SUM,
+    PAGE_FIRST_SIPM_SUMS,
+    PAGE_MEAN_ADC = PAGE_FIRST_SIPM_SUMS + 25,
+    PAGE_GAIN_FACTORS,
+    ADC_SINGLE_SUM_PAGES,
+    ADC_FULL_SUM_PAGES = PAGE_GAIN_FACTORS
+};
+
+// The 25 crystal sums with their fits
+static void draw_crystal_sums(const AdcSumResults &results, bool full, TCanvas *c) {
+    const std::vector<TH1D*> &crystal_sums = full ? results.spectra.crystal_full_sums : results.spectra.crystal_single_sums;
+    int lower_range = (full ? 1150 : 200) * sipms_per_crystal[results.readout];
+    int upper_range = (full ? 1800 : 900) * sipms_per_crystal[results.readout];
+
+    double max_value = 0;
+    for (int crystal = 0; crystal < 25; crystal++) {
+        TF1 *fit = crystal_sums[crystal]->GetFunction("fit");
+        if (fit && fit->Eval(fit->GetParameter(1)) > max_value) {
+            max_value = fit->Eval(fit->GetParameter(full ? 1 : 2));
+        }
+    }
+    std::cout << "max is " << max_value << std::endl;
+
+    c->cd(0);
+    auto label = new TLatex();
+    label->SetNDC();
+    label->SetTextSize(0.05);
+    label->DrawLatex(0.05, 0.9, Form("Crystal ADC Sums %s", results.title.c_str()));
+
+    auto pad = new TPad("pad", "pad", 0.05, 0.05, 0.95, 0.85);
+    pad->Draw();
+    // Add text to the top of the pad with the run and event number
+    pad->cd();
+    pad->Divide(5, 5, 0.000, 0.000);
+    
+    for (int crystal = 0; crystal < 25; crystal++) {
+        pad->cd(crystal+1);
+        auto fit = crystal_sums[crystal]->GetFunction("fit");
+        
+        crystal_sums[crystal]->SetTitle("");
+        crystal_sums[crystal]->Draw("e");
+        if (!full) {
+            crystal_sums[crystal]->SetMaximum(max_value * 3);
+        }
+        crystal_sums[crystal]->GetXaxis()->SetLabelSize(0.06);
+        crystal_sums[crystal]->GetYaxis()->SetLabelSize(0.06);
+        crystal_sums[crystal]->GetXaxis()->SetTitle("");
+        crystal_sums[crystal]->GetYaxis()->SetTitle("");
+        
+        TLatex latex;
+        latex.SetNDC();
+        latex.SetTextSize(0.08);
+        latex.SetTextAlign(33);
+        latex.DrawLatex(0.95, 0.95, Form("Crystal %d", crystal_ID[crystal]));
+        if (fit) {
+            int entries_in_range = crystal_sums[crystal]->Integral(crystal_sums[crystal]->FindBin(lower_range), crystal_sums[crystal]->FindBin(upper_range));
+            double mean = fit->GetParameter(2);
+            double stddev = fit->GetParameter(3);
+            double mean_error = fit->GetParError(2);
+            double stddev_error = fit->GetParError(3);
+            double stddev_over_mean = stddev/mean;
+            double stddev_over_mean_error = stddev_over_mean * sqrt(pow(mean_error/mean, 2) + pow(stddev_error/stddev, 2));
+            latex.DrawLatex(0.95, 0.85, Form("Mean = %.2f#pm%.2f", mean, mean_error));
+            latex.DrawLatex(0.95, 0.75, Form("StdDev = %.2f#pm%.2f", stddev, stddev_error));
+            latex.DrawLatex(0.95, 0.65, Form("StdDev/Mean = %.2f#pm%.4f", stddev_over_mean, stddev_over_mean_error));
+            latex.DrawLatex(0.95, 0.55, Form("Entries in range = %d", entries_in_range));
+            latex.DrawLatex(0.95, 0.45, Form("n, #alpha, N: %.2f, %.2f, %.2f", fit->GetParameter(1), fit->GetParameter(0), fit->GetParameter(4)));
+        }
+    }
+
+    c->cd(0);
+    label->SetTextSize(0.03);
+    label->SetTextAlign(33);
+    label->SetTextAngle(90);
+    label->DrawLatex(0.04, 0.85, "Counts/4 ADC");
+    label->SetTextAngle(0);
+    label->DrawLatex(0.925, 0.05, "ADC");
+}
+
+// Sum over the center 9 crystals or the full calorimeter with its fit
+static void draw_calo_sum(TH1D *calo_sum, const char *title, double parameters_x) {
+    auto fit = calo_sum->GetFunction("fit");
+    calo_sum->SetTitle(title);
+    calo_sum->Draw("e");
+    if (!fit) {
+        return;
+    }
+    double mean = fit->GetParameter(2);
+    double stddev = fit->GetParameter(3);
+    double mean_error = fit->GetParError(2);
+    double stddev_error = fit->GetParError(3);
+    double stddev_over_mean = stddev/mean;
+    double stddev_over_mean_error = stddev_over_mean * sqrt(pow(mean_error/mean, 2) + pow(stddev_error/stddev, 2));
+
+    TLatex latex;
+    latex.SetNDC();
+    latex.SetTextSize(0.04);
+    latex.SetTextAlign(33);
+    latex.DrawLatex(0.89, 0.85, Form("Mean = %.2f#pm%.2f", mean, mean_error));
+    latex.DrawLatex(0.89, 0.8, Form("StdDev = %.2f#pm%.2f", stddev, stddev_error));
+    latex.DrawLatex(0.89, 0.75, Form("StdDev/Mean = %.2f#pm%.4f", stddev_over_mean, stddev_over_mean_error));
+    latex.DrawLatex(parameters_x, 0.7, Form("n, #alpha, N: %.2f, %.2f, %.2f", fit->GetParameter(1), fit->GetParameter(0), fit->GetParameter(4)));
+}
+
+// The SiPM sums of one crystal with their fits
+static void draw_sipm_sums(const AdcSumResults &results, bool full, int crystal, TCanvas *canvas) {
+    int n_sipms = sipms_per_crystal[results.readout];
+    const std::vector<TH1D*> &sipm_sums = full ? results.spectra.sipm_full_sums : results.spectra.sipm_single_sums;
+    canvas->cd(0);
+    auto label = new TLatex();
+    label->SetNDC();
+    label->SetTextSize(0.05);
+    label->DrawLatex(0.05, 0.9, Form("Crystal %d SiPM ADC Sums %s", crystal_ID[crystal], results.title.c_str()));
+    auto pad = new TPad("pad", "pad", 0.05, 0.05, 0.95, 0.85);
+    pad->Draw();
+    pad->cd();
+    pad->Divide(4, 4, 0.000, 0.000);
+    TLatex latex;
+    latex.SetNDC();
+    latex.SetTextSize(0.06);
+    latex.SetTextAlign(33);
+    for (int sipm = 0; sipm < n_sipms; sipm++) {
+        pad->cd(sipm+1);
+        TH1D *sipm_sum = sipm_sums[crystal * n_sipms + sipm];
+        auto fit = sipm_sum->GetFunction("fit");
+        sipm_sum->Draw("e");
+        if (!fit) {
+            continue;
+        }
+        TH1D *range_binning = results.spectra.sipm_single_sums[crystal * n_sipms + sipm];
+        int entries_in_range = sipm_sum->Integral(sipm_sum->FindBin(200), range_binning->FindBin(900));
+        double mean = fit->GetParameter(2);
+        double stddev = fit->GetParameter(3);
+        double mean_error = fit->GetParError(2);
+        double stddev_error = fit->GetParError(3);
+        double stddev_over_mean = stddev/mean;
+        double stddev_over_mean_error = stddev_over_mean * sqrt(pow(mean_error/mean, 2) + pow(stddev_error/stddev, 2));
+        latex.DrawLatex(0.95, 0.85, Form("Mean = %.2f#pm%.2f", mean, mean_error));
+        latex.DrawLatex(0.95, 0.75, Form("StdDev = %.2f#pm%.2f", stddev, stddev_error));
+        latex.DrawLatex(0.95, 0.65, Form("StdDev/Mean = %.2f#pm%.4f", stddev_over_mean, stddev_over_mean_error));
+        latex.DrawLatex(0.95, 0.55, Form("Entries in range = %d", entries_in_range));
+        latex.DrawLatex(0.95, 0.45, Form("n, #alpha, N: %.2f, %.2f, %.2f", fit->GetParameter(1), fit->GetParameter(0), fit->GetParameter(4)));
+    }
+}
+
+static void draw_adc_sum_page(const AdcSumResults &results, bool full, int page, TCanvas *canvas) {
+    const AdcSumSpectra &spectra = results.spectra;
+    if (page == PAGE_CRYSTAL_SUMS) {
+        draw_crystal_sums(results, full, canvas);
+    } else if (page == PAGE_CENTER_SUM) {
+        draw_calo_sum(full ? spectra.center_calo_full_sum : spectra.center_calo_single_sum, "Central 9 Crystals", 0.89);
+    } else if (page == PAGE_FULL_CALO_SUM) {
+        draw_calo_sum(full ? spectra.full_calo_full_sum : spectra.full_calo_single_sum, "Full Calorimeter", full ? 0.95 : 0.89);
+    } else if (page < PAGE_MEAN_ADC) {
+        draw_sipm_sums(results, full, page - PAGE_FIRST_SIPM_SUMS, canvas);
+    } else if (page == PAGE_MEAN_ADC) {
+        results.mean_ADC->Draw("e");
+        results.mean_ADC->GetYaxis()->SetRangeUser(0, 1024);
+        TLine *line = new TLine(0, GAIN_TARGET, 400, GAIN_TARGET);
+        line->SetLineColor(kRed);
+        line->SetLineWidth(2);
+        line->SetLineStyle(2); // Set line style to dashed
+        line->Draw();
+    } else {
+        results.gain_factors->Draw("e");
+        // results.gain_factors->GetYaxis()->SetRangeUser(0, 3);
+    }
+}
+
+// Pages [first, last) of the single or full sum document of a results file
+static bool render_adc_sum_pages(const std::string &results_file, bool full, int first, int last, const std::string &pdf) {
+    std::unique_ptr<TFile> file(TFile::Open(results_file.c_str()));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening " << results_file << std::endl;
+        return false;
+    }
+    AdcSumResults results;
+    if (!load_adc_sum_results(file.get(), results)) {
+        return false;
+    }
+    gStyle->SetOptStat(0);
+    for (int page = first; page < last; page++) {
+        std::unique_ptr<TCanvas> canvas(new TCanvas(Form("adc_sum_page_%02d", page), "c", 1600, 1200));
+        canvas->cd();
+        draw_adc_sum_page(results, full, page, canvas.get());
+        save_page(canvas.get(), pdf, page, first, last);
+    }
+    return true;
+}
+
+std::vector<RenderJob> adc_sum_render_jobs(const std::string &output_file) {
+    std::string results_file = adc_sum_results_path(output_file);
+    return {
+        {Form("output/%s_adc_single_sum.pdf", output_file.c_str()), ADC_SINGLE_SUM_PAGES,
+         [=](int first, int last, const std::string &pdf) { return render_adc_sum_pages(results_file, false, first, last, pdf); }},
+        {Form("output/%s_adc_full_sum.pdf", output_file.c_str()), ADC_FULL_SUM_PAGES,
+         [=](int first, int last, const std::string &pdf) { return render_adc_sum_pages(results_file, true, first, last, pdf); }},
+    };
+}
+
+bool single_crystal_ADC_sum_offline(int run_number, int n_threads, bool use_cache, double beam_energy) {
+    int readout = 0;
+    gStyle->SetOptStat(0);
+    auto path = getenv("OUTPUT_PATH");
+    TFile *file = new TFile(Form("%s/Run%03d.root", path, run_number));
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening file" << std::endl;
+        return false;
+    }
+
+    TTree *tree = nullptr;
+    file->GetObject("events", tree);
+    if (!tree) {
+        std::cerr << "Error getting tree from file" << std::endl;
+        return false;
+    }
+
+    // Read the gain correction and ToT conversion constants, if they exist
+    Calibration calibration;
+    load_calibration("output/gain_matching.root", "output/tot_conversion.root", calibration);
+
+    // Each chunk of the run fills its own histograms, merged in chunk order
+    const ChannelMap &channel_map = eeemcal_channel_maps[readout];
+    std::unique_ptr<AdcSumHistograms> totals(new AdcSumHistograms(readout));
+    std::vector<EntryRange> chunks = make_entry_chunks(tree, CHUNK_ENTRIES);
+    auto merge = [&](AdcSumHistograms &chunk_histograms) {
+        totals->add(chunk_histograms);
+    };
+
+    // The features of a run do not depend on the calibration, so they are
+    // cached on the first pass and later passes only re-apply the corrections
+    std::string source_uuid = file->GetUUID().AsString();
+    std::string cache_dir = feature_cache_dir(run_number, readout);
+    bool from_cache = use_cache && feature_cache_valid(cache_dir, source_uuid, chunks, channel_map);
+    if (use_cache && !from_cache) {
+        gSystem->mkdir(cache_dir.c_str(), true);
+    }
+    bool ok;
+    if (from_cache) {
+        std::cout << "Reading features from " << cache_dir << std::endl;
+        ok = ordered_reduce<AdcSumHistograms>(chunks.size(), n_threads,
+            [&](int chunk, int thread) {
+                FeatureCacheReader cache(feature_cache_chunk_path(cache_dir, chunk), channel_map);
+                if (!cache.is_valid()) {
+                    return std::unique_ptr<AdcSumHistograms>();
+                }
+                std::unique_ptr<AdcSumHistograms> histograms(new AdcSumHistograms(readout));
+                WaveformFeatures features;
+                HitList hits;
+                for (Long64_t event = 0; event < cache.n_entries(); event++) {
+                    if (!cache.get_entry(event, features)) {
+                        return std::unique_ptr<AdcSumHistograms>();
+                    }
+                    find_hits(features, hits);
+                    histograms->fill(features, hits, channel_map, calibration);
+                }
+                return histograms;
+            },
+            merge);
+    } else {
+        ok = process_chunks<AdcSumHistograms>(file->GetName(), BRANCH_ADC | BRANCH_TOT, chunks, n_threads,
+            [&](EventReader &chunk_reader, int chunk) {
+                std::unique_ptr<FeatureCacheWriter> cache;
+                if (use_cache) {
+                    cache.reset(new FeatureCacheWriter(feature_cache_chunk_path(cache_dir, chunk), channel_map));
+                }
+                std::unique_ptr<AdcSumHistograms> histograms(new AdcSumHistograms(readout));
+                WaveformFeatures features;
+                PedestalTracker pedestals;
+                HitList hits;
+                for (Long64_t event = chunks[chunk].first; event < chunks[chunk].last; event++) {
+                    if (!pedestals.read(chunk_reader, event, channel_map)) {
+                        return std::unique_ptr<AdcSumHistograms>();
+                    }
+                    extract_features(chunk_reader.adc(), chunk_reader.tot(), nullptr, channel_map, pedestals.snapshot(), features);
+                    if (cache && cache->is_valid()) {
+                        cache->fill(features);
+                    }
+                    find_hits(features, hits);
+                    histograms->fill(features, hits, channel_map, calibration);
+                }
+                if (cache && !cache->close(source_uuid, chunks[chunk])) {
+                    std::cerr << "Error writing feature cache chunk " << chunk << std::endl;
+                }
+                return histograms;
+            },
+            merge);
+    }
+    if (!ok) {
+        std::cerr << "Error reading events" << std::endl;
+        return false;
+    }
+
+    return fit_adc_sums(*totals, readout, run_output_name(run_number), n_threads, beam_energy);
+}
+
+// Online summary: the spectra so far, and the gain factors from the mean of
+// each SiPM spectrum in the peak region instead of a fit
+static void write_online_summary(AdcSumHistograms &totals, const ChannelMap &channel_map, int run_number) {
+    totals.pad();
+    AdcSumSpectra spectra = make_spectra(totals, channel_map.readout);
+    std::vector<TObject*> objects = spectra.all();
+
+    TH1D *mean_ADC = new TH1D("mean_ADC", "Mean ADC;Channel;Mean ADC", channel_map.n_mapped, 0, channel_map.n_mapped);
+    TH1F *gain_factors = new TH1F("gain_factors", "Gain Factors;Channel;Gain Factor", 576, 0, 576);
+    mean_ADC->SetDirectory(nullptr);
+    gain_factors->SetDirectory(nullptr);
+    for (int i = 0; i < channel_map.n_mapped; i++) {
+        TH1D *sipm_sum = spectra.sipm_single_sums[i];
+        sipm_sum->GetXaxis()->SetRangeUser(200, 900);
+        double mean = sipm_sum->GetMean();
+        sipm_sum->GetXaxis()->SetRange(0, 0);
+        mean_ADC->SetBinContent(i + 1, mean);
+        gain_factors->SetBinContent(channel_map.channel[i] + FIRST_CHANNEL_BIN, mean > 1 ? GAIN_TARGET / mean : 1);
+    }
+    TParameter<int> first_channel_bin("first_channel_bin", FIRST_CHANNEL_BIN);
+    objects.insert(objects.end(), {mean_ADC, gain_factors, &first_channel_bin});
+
+    write_online_file(Form("output/Run%03d_adc_sum_online.root", run_number), objects);
+    objects.pop_back();
+    for (auto object : objects) {
+        delete object;
+    }
+}
+
+bool single_crystal_ADC_sum_follow(int run_number, const FollowOptions &options, int n_threads, double beam_energy) {
+    int readout = 0;
+    auto path = getenv("OUTPUT_PATH");
+    Calibration calibration;
+    load_calibration("output/gain_matching.root", "output/tot_conversion.root", calibration);
+
+    const ChannelMap &channel_map = eeemcal_channel_maps[readout];
+    AdcSumHistograms totals(readout);
+    WaveformFeatures features;
+    PedestalTracker pedestals;
+    HitList hits;
+    FollowStatus status = follow_run(Form("%s/Run%03d.root", path, run_number), BRANCH_ADC | BRANCH_TOT, options,
+        [&](EventReader &reader, Long64_t first, Long64_t last) {
+            for (Long64_t event = first; event < last; event++) {
+                if (!pedestals.read(reader, event, channel_map)) {
+                    std::cerr << "Error reading event " << event << std::endl;
+                    return false;
+                }
+                extract_features(reader.adc(), reader.tot(), nullptr, channel_map, pedestals.snapshot(), features);
+                find_hits(features, hits);
+                totals.fill(features, hits, channel_map, calibration);
+            }
+            return true;
+        },
+        [&]() {
+            write_online_summary(totals, channel_map, run_number);
+        });
+    // The decoder marked the run complete, so the totals hold every event,
+    // with the same pedestals, and give the same fits and plots as the
+    // offline pass
+    if (status != FOLLOW_DONE) {
+        std::cerr << "Run " << run_number << " was not completed, no fits" << std::endl;
+        return false;
+    }
+    return fit_adc_sums(totals, readout, run_output_name(run_number), n_threads, beam_energy);
+}
+
+// Module of the fused driver, with the same outputs as single_crystal_ADC_sum.
+// With use_cache it also writes the feature cache of the run, unless a valid
+// one exists, so a later single_crystal_ADC_sum rerun reads the cache.
+class AdcSumModule : public AnalysisModule {
+public:
+    AdcSumModule(int run_number, int n_threads, bool use_cache, double beam_energy)
+        : run_number(run_number), n_threads(n_threads), use_cache(use_cache), beam_energy(beam_energy), totals(READOUT_16I) {
+        load_calibration("output/gain_matching.root", "output/tot_conversion.root", calibration);
+    }
+
+    const char *name() const override { return "single_crystal_ADC_sum"; }
+    int branches() const override { return BRANCH_ADC | BRANCH_TOT; }
+
+    void begin(const std::string &run_uuid, const std::vector<EntryRange> &run_chunks) override {
+        source_uuid = run_uuid;
+        chunks = run_chunks;
+        cache_dir = feature_cache_dir(run_number, READOUT_16I);
+        write_cache = use_cache && !feature_cache_valid(cache_dir, source_uuid, chunks, eeemcal_channel_maps[READOUT_16I]);
+        if (write_cache) {
+            gSystem->mkdir(cache_dir.c_str(), true);
+            std::cout << "Writing features to " << cache_dir << std::endl;
+        }
+    }
+    std::unique_ptr<ModuleState> make_state(int chunk) const override {
+        return std::unique_ptr<ModuleState>(new State(*this, chunk));
+    }
+    void merge(ModuleState &state) override {
+        totals.add(static_cast<State &>(state).histograms);
+    }
+    void finish() override {
+        fit_adc_sums(totals, READOUT_16I, run_output_name(run_number), n_threads, beam_energy);
+    }
+
+private:
+    struct State : public ModuleState {
+        const AdcSumModule &module;
+        int chunk;
+        AdcSumHistograms histograms;
+        std::unique_ptr<FeatureCacheWriter> cache;
+
+        State(const AdcSumModule &module, int chunk) : module(module), chunk(chunk), histograms(READOUT_16I) {
+            if (module.write_cache) {
+                cache.reset(new FeatureCacheWriter(feature_cache_chunk_path(module.cache_dir, chunk), eeemcal_channel_maps[READOUT_16I]));
+            }
+        }
+        void process(Long64_t, EventReader &, const WaveformFeatures &features, const HitList &hits) override {
+            if (cache && cache->is_valid()) {
+                cache->fill(features);
+            }
+            histograms.fill(features, hits, eeemcal_channel_maps[READOUT_16I], module.calibration);
+        }
+        void end_chunk() override {
+            if (cache && !cache->close(module.source_uuid, module.chunks[chunk])) {
+                std::cerr << "Error writing feature cache chunk " << chunk << std::endl;
+            }
+        }
+    };
+
+    int run_number;
+    int n_threads;
+    bool use_cache;
+    double beam_energy;
+    Calibration calibration;
+    AdcSumHistograms totals;
+    bool write_cache = false;
+    std::string cache_dir;
+    std::string source_uuid;
+    std::vector<EntryRange> chunks;
+};
+
+std::unique_ptr<AnalysisModule> make_adc_sum_module(int run_number, int n_threads, bool use_cache, double beam_energy) {
+    return std::unique_ptr<AnalysisModule>(new AdcSumModule(run_number, n_threads, use_cache, beam_energy));
+}
+
+bool merge_adc_sum_runs(const std::string &name, const std::vector<int> &runs, int n_threads) {
+    int readout = READOUT_16I;
+    AdcSumHistograms totals(readout);
+    std::vector<double> beam_energies(runs.size(), 0);
+    // The accumulators are read on the worker threads and added in run order
+    bool ok = ordered_reduce<AdcSumHistograms>(runs.size(), n_threads,
+        [&](int i, int thread) {
+            std::string path = accumulator_path(run_output_name(runs[i]).file, "adc_sum");
+            std::unique_ptr<TFile> file(TFile::Open(path.c_str()));
+            if (!file || file->IsZombie()) {
+                std::cerr << "Error opening " << path << std::endl;
+                return std::unique_ptr<AdcSumHistograms>();
+            }
+            TParameter<int> *file_readout = nullptr;
+            TParameter<double> *beam_energy = nullptr;
+            file->GetObject("readout", file_readout);
+            file->GetObject("beam_energy", beam_energy);
+            std::unique_ptr<TParameter<int>> owned_readout(file_readout);
+            std::unique_ptr<TParameter<double>> owned_beam_energy(beam_energy);
+            if (!file_readout || file_readout->GetVal() != readout || !beam_energy) {
+                std::cerr << path << " is not a 16i ADC sum accumulator file" << std::endl;
+                return std::unique_ptr<AdcSumHistograms>();
+            }
+            beam_energies[i] = beam_energy->GetVal();
+            std::unique_ptr<AdcSumHistograms> histograms(new AdcSumHistograms(readout));
+            if (!histograms->add_from(file.get())) {
+                return std::unique_ptr<AdcSumHistograms>();
+            }
+            return histograms;
+        },
+        [&](AdcSumHistograms &histograms) {
+            totals.add(histograms);
+        });
+    if (!ok) {
+        return false;
+    }
+    std::cout << "Merged " << runs.size() << " runs, " << totals.n_events << " events" << std::endl;
+
+    // Fit seeds only apply if all runs share a beam energy
+    double beam_energy = beam_energies.empty() ? 0 : beam_energies[0];
+    for (double run_energy : beam_energies) {
+        if (run_energy != beam_energy) {
+            std::cerr << "The runs have different beam energies, the fits start from the defaults" << std::endl;
+            beam_energy = 0;
+            break;
+        }
+    }
+    return fit_adc_sums(totals, readout, {name, name, -1}, n_threads, beam_energy);
+}
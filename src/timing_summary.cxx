@@ -0,0 +1,184 @@
+#include "eeemcal_analyses.h"
+#include "eeemcal_histogram_bank.h"
+#include "eeemcal_mapping.h"
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TParameter.h>
+#include <TString.h>
+
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Upper edge of the ADC at TOA spectra
+static const double ADC_AT_TOA_MAX = 1024;
+
+std::string timing_summary_path(int run) {
+    return Form("output/Run%03d_timing.root", run);
+}
+
+// Per channel counts of the timing anomalies.  A TOA or ToT hit is a
+// waveform with at least one nonzero sample; a multi hit has more than one,
+// which the single sample timing below cannot describe.
+struct TimingCounters {
+    std::vector<Long64_t> toa_hits;
+    std::vector<Long64_t> multi_toa;
+    std::vector<Long64_t> tot_hits;
+    std::vector<Long64_t> multi_tot;
+
+    TimingCounters(int n_channels)
+        : toa_hits(n_channels), multi_toa(n_channels), tot_hits(n_channels), multi_tot(n_channels) {}
+
+    void add(const TimingCounters &other) {
+        for (size_t i = 0; i < toa_hits.size(); i++) {
+            toa_hits[i] += other.toa_hits[i];
+            multi_toa[i] += other.multi_toa[i];
+            tot_hits[i] += other.tot_hits[i];
+            multi_tot[i] += other.multi_tot[i];
+        }
+    }
+};
+
+// Sample of the first TOA, sample of the largest ToT and pedestal subtracted
+// ADC at the TOA of every SiPM, filled into the spectra of its crystal, and
+// the anomaly counters of every SiPM.  All of it comes from the extracted
+// features, so the per event cost is one pass over the mapped channels with
+// no I/O; the counters are reported once when the run is done.
+class TimingSummaryModule : public AnalysisModule {
+public:
+    TimingSummaryModule(int run) : run(run), timing(make_timing()) {}
+
+    const char *name() const override { return "timing"; }
+    int branches() const override { return BRANCH_ADC | BRANCH_TOT | BRANCH_TOA; }
+
+    std::unique_ptr<ModuleState> make_state(int) const override {
+        return std::unique_ptr<ModuleState>(new State(make_timing()));
+    }
+    void merge(ModuleState &state) override {
+        const Timing &chunk = static_cast<State &>(state).timing;
+        timing.toa_sample.add(chunk.toa_sample);
+        timing.tot_sample.add(chunk.tot_sample);
+        timing.adc_at_toa.add(chunk.adc_at_toa);
+        timing.counters.add(chunk.counters);
+        timing.n_events += chunk.n_events;
+    }
+    void finish() override {
+        report();
+        std::string path = timing_summary_path(run);
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error writing " << path << std::endl;
+            return;
+        }
+        for (int crystal = 0; crystal < NUM_CRYSTALS; crystal++) {
+            int id = crystal_ID[crystal];
+            std::unique_ptr<TH1D> toa(timing.toa_sample.to_th1(crystal, Form("toa_sample_%d", id),
+                                                                Form("Crystal %d TOA Sample;Sample;SiPMs", id)));
+            std::unique_ptr<TH1D> tot(timing.tot_sample.to_th1(crystal, Form("tot_sample_%d", id),
+                                                                Form("Crystal %d ToT Sample;Sample;SiPMs", id)));
+            std::unique_ptr<TH1D> adc(timing.adc_at_toa.to_th1(crystal, Form("adc_at_toa_%d", id),
+                                                                Form("Crystal %d ADC at TOA;ADC;SiPMs", id)));
+            toa->Write();
+            tot->Write();
+            adc->Write();
+        }
+        // The counters per mapped channel, as histograms over the channel index
+        const std::vector<Long64_t> *counts[4] = {&timing.counters.toa_hits, &timing.counters.multi_toa,
+                                                  &timing.counters.tot_hits, &timing.counters.multi_tot};
+        const char *names[4] = {"toa_hits", "multi_toa", "tot_hits", "multi_tot"};
+        for (int i = 0; i < 4; i++) {
+            TH1D hist(names[i], Form("%s;Channel index;Events", names[i]), n_channels, 0, n_channels);
+            hist.SetDirectory(nullptr);
+            for (int channel = 0; channel < n_channels; channel++) {
+                hist.SetBinContent(channel + 1, (*counts[i])[channel]);
+            }
+            hist.SetEntries(n_channels);
+            hist.Write();
+        }
+        TParameter<Long64_t>("n_events", timing.n_events).Write();
+        file->Close();
+        std::cout << "Wrote " << path << std::endl;
+    }
+
+private:
+    struct Timing {
+        HistogramBank1D toa_sample;
+        HistogramBank1D tot_sample;
+        HistogramBank1D adc_at_toa;
+        TimingCounters counters;
+        Long64_t n_events = 0;
+    };
+
+    static Timing make_timing() {
+        return {HistogramBank1D(NUM_CRYSTALS, NUM_SAMPLES, -0.5, NUM_SAMPLES - 0.5),
+                HistogramBank1D(NUM_CRYSTALS, NUM_SAMPLES, -0.5, NUM_SAMPLES - 0.5),
+                HistogramBank1D(NUM_CRYSTALS, 256, 0, ADC_AT_TOA_MAX),
+                TimingCounters(eeemcal_channel_maps[READOUT_16I].n_mapped)};
+    }
+
+    struct State : public ModuleState {
+        Timing timing;
+
+        State(Timing timing) : timing(std::move(timing)) {}
+
+        // Every channel with a ToT is a hit, but a TOA can come with an
+        // amplitude below the hit threshold, so those are taken from the
+        // features of every channel
+        void process(Long64_t, EventReader &, const WaveformFeatures &features, const HitList &hits) override {
+            const int n_sipms = eeemcal_channel_maps[READOUT_16I].n_sipms;
+            TimingCounters &counters = timing.counters;
+            for (int i = 0; i < features.n_channels; i++) {
+                if (features.n_toa[i] > 0) {
+                    int crystal = i / n_sipms;
+                    counters.toa_hits[i]++;
+                    counters.multi_toa[i] += features.n_toa[i] > 1;
+                    timing.toa_sample.fill(crystal, features.toa_sample[i]);
+                    timing.adc_at_toa.fill(crystal, features.adc_at_toa[i]);
+                }
+            }
+            for (const Hit &hit : hits) {
+                int i = hit.index;
+                int crystal = i / n_sipms;
+                if (hit.n_tot > 0) {
+                    counters.tot_hits[i]++;
+                    counters.multi_tot[i] += hit.n_tot > 1;
+                    timing.tot_sample.fill(crystal, features.tot_sample[i]);
+                }
+            }
+            timing.n_events++;
+        }
+    };
+
+    // One line for the run, then the channels with multi hits
+    void report() const {
+        const TimingCounters &counters = timing.counters;
+        Long64_t totals[4] = {0, 0, 0, 0};
+        for (int channel = 0; channel < n_channels; channel++) {
+            totals[0] += counters.toa_hits[channel];
+            totals[1] += counters.multi_toa[channel];
+            totals[2] += counters.tot_hits[channel];
+            totals[3] += counters.multi_tot[channel];
+        }
+        std::cout << "Timing, " << timing.n_events << " events: " << totals[0] << " TOA hits (" << totals[1] << " multiple), "
+                  << totals[2] << " ToT hits (" << totals[3] << " multiple)" << std::endl;
+        const int n_sipms = eeemcal_channel_maps[READOUT_16I].n_sipms;
+        for (int channel = 0; channel < n_channels; channel++) {
+            if (counters.multi_toa[channel] == 0 && counters.multi_tot[channel] == 0) {
+                continue;
+            }
+            std::cout << "  crystal " << crystal_ID[channel / n_sipms] << " SiPM " << channel % n_sipms
+                      << ": " << counters.multi_toa[channel] << "/" << counters.toa_hits[channel] << " multiple TOA, "
+                      << counters.multi_tot[channel] << "/" << counters.tot_hits[channel] << " multiple ToT" << std::endl;
+        }
+    }
+
+    int run;
+    const int n_channels = eeemcal_channel_maps[READOUT_16I].n_mapped;
+    Timing timing;
+};
+
+std::unique_ptr<AnalysisModule> make_timing_summary_module(int run) {
+    return std::unique_ptr<AnalysisModule>(new TimingSummaryModule(run));
+}